@@ -0,0 +1,233 @@
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "push.hh"
+#include "relex.hh"
+
+// checks relex and push_lexer against lexing the whole text with
+// lexer::next_batch. the text is edited at random, with the edits at its
+// start, at its end and inside its last token as well as pure inserts and
+// deletes in every round, and after every edit the updated tokens have to
+// match a full lex of the edited text. every text is then fed to a
+// push_lexer in random pieces, split anywhere inside tokens and, on utf-8
+// input, inside code points, and restored from a checkpoint taken on the
+// way. stops at the first mismatch
+static bool same_tokens(token_buffer &a, token_buffer &b, size_t from) {
+    if (a.size - from != b.size) {
+        return false;
+    }
+    for (size_t i = 0; i < b.size; i++) {
+        if (a.kinds[from + i] != b.kinds[i] ||
+            a.starts[from + i] != b.starts[i] ||
+            a.lengths[from + i] != b.lengths[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string encode(std::vector<input_unit> &units) {
+#ifdef LEXER_UTF8
+    return std::string(units.begin(), units.end());
+#else
+    std::stringstream out;
+    utf32::stringref ref(units.data(), units.size());
+    out << ref;
+    return out.str();
+#endif
+}
+
+static token_buffer pull(std::vector<input_unit> &units) {
+    lexer l{input::stream(encode(units))};
+    token_buffer tokens;
+    token_buffer batch;
+    while (1) {
+        size_t count = l.next_batch(batch, 1 << 10);
+        for (size_t i = 0; i < count; i++) {
+            tokens.reserve(tokens.size + 1);
+            tokens.kinds[tokens.size] = batch.kinds[i];
+            tokens.starts[tokens.size] = batch.starts[i];
+            tokens.lengths[tokens.size] = batch.lengths[i];
+            tokens.size++;
+        }
+        if (count == 0 || batch.kinds[count - 1] == token::ERROR) {
+            break;
+        }
+    }
+    tokens.kinds.resize(tokens.size);
+    tokens.starts.resize(tokens.size);
+    tokens.lengths.resize(tokens.size);
+    return tokens;
+}
+
+static text_edit random_edit(std::vector<input_unit> &units,
+                             token_buffer &tokens, size_t kind,
+                             std::mt19937_64 &rng) {
+    size_t length = units.size();
+    text_edit edit{rng() % (length + 1), 0, 1 + rng() % 8};
+    edit.removed = std::min<size_t>(1 + rng() % 8, length - edit.offset);
+    switch (kind) {
+        case 0:
+            edit.offset = 0;
+            edit.removed = std::min<size_t>(rng() % 4, length);
+            break;
+        case 1:
+            edit.offset = length;
+            edit.removed = 0;
+            break;
+        case 2: {
+            // inside the last token before the final ERROR
+            size_t last = tokens.size >= 2 ? tokens.size - 2 : 0;
+            if (tokens.size >= 2 && tokens.lengths[last] > 0) {
+                edit.offset =
+                    tokens.starts[last] + rng() % tokens.lengths[last];
+                edit.removed =
+                    std::min<size_t>(rng() % 3, length - edit.offset);
+            }
+            break;
+        }
+        case 3:
+            edit.removed = 0;
+            break;
+        case 4:
+            edit.inserted = 0;
+            break;
+    }
+    return edit;
+}
+
+static bool check_relex(std::vector<input_unit> &units, size_t rounds,
+                        std::mt19937_64 &rng) {
+    std::vector<input_unit> original = units;
+    token_buffer tokens = pull(units);
+    size_t relexed = 0;
+    size_t total = 0;
+    for (size_t round = 0; round < rounds; round++) {
+        text_edit edit = random_edit(units, tokens, round % 6, rng);
+        // inserted units are copied from the text, so they mostly form
+        // tokens of its language
+        std::vector<input_unit> inserted;
+        for (size_t i = 0; i < edit.inserted; i++) {
+            inserted.push_back(original[rng() % original.size()]);
+        }
+        units.erase(units.begin() + edit.offset,
+                    units.begin() + edit.offset + edit.removed);
+        units.insert(units.begin() + edit.offset, inserted.begin(),
+                     inserted.end());
+        token_range range = relex(tokens, units.data(), units.size(), edit);
+        token_buffer reference = pull(units);
+        if (!same_tokens(reference, tokens, 0)) {
+            std::cerr << "relex differs from a full lex after replacing "
+                      << edit.removed << " units at " << edit.offset
+                      << " by " << edit.inserted << " in round " << round
+                      << std::endl;
+            return false;
+        }
+        relexed += range.count_after;
+        total += reference.size;
+        if (units.size() > 4 * original.size() ||
+            units.size() < original.size() / 4) {
+            units = original;
+            tokens = pull(units);
+        }
+    }
+    std::cout << "relex: " << rounds << " edits, " << relexed
+              << " tokens lexed again of " << total << std::endl;
+    return true;
+}
+
+static bool check_push(std::vector<input_unit> &units, size_t rounds,
+                       std::mt19937_64 &rng) {
+    token_buffer reference = pull(units);
+    for (size_t round = 0; round < rounds; round++) {
+        // the first rounds feed tiny pieces, so most tokens span several
+        size_t piece = 1 + rng() % (round < rounds / 4 ? 4 : 256);
+        size_t checkpoint = rng() % (units.size() + 1);
+        lexer_state saved{};
+        bool have_saved = false;
+        push_lexer pusher;
+        token_buffer tokens;
+        size_t position = 0;
+        while (position < units.size()) {
+            size_t length =
+                std::min<size_t>(units.size() - position, 1 + rng() % piece);
+            pusher.feed(units.data() + position, length, tokens);
+            position += length;
+            if (!have_saved && position >= checkpoint) {
+                saved = pusher.state();
+                have_saved = true;
+            }
+        }
+        pusher.finish(tokens);
+        if (!same_tokens(reference, tokens, 0)) {
+            std::cerr << "push lexing in pieces of up to " << piece
+                      << " units differs from pull lexing" << std::endl;
+            return false;
+        }
+        if (!have_saved) {
+            continue;
+        }
+        push_lexer restored(saved);
+        token_buffer rest;
+        position = saved.start;
+        while (position < units.size()) {
+            size_t length =
+                std::min<size_t>(units.size() - position, 1 + rng() % piece);
+            restored.feed(units.data() + position, length, rest);
+            position += length;
+        }
+        restored.finish(rest);
+        size_t from = 0;
+        while (from < reference.size && reference.starts[from] < saved.start) {
+            from++;
+        }
+        if (!same_tokens(reference, rest, from)) {
+            std::cerr << "push lexing restored at " << saved.start
+                      << " differs from pull lexing" << std::endl;
+            return false;
+        }
+    }
+    std::cout << "push: " << rounds << " splits of " << units.size()
+              << " units" << std::endl;
+    return true;
+}
+
+int main(int argc, char const *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <input> [rounds] [seed]"
+                  << std::endl;
+        return 1;
+    }
+    mapped_file file(argv[1]);
+    size_t rounds = argc > 2 ? std::stoul(argv[2]) : 1000;
+    std::mt19937_64 rng(argc > 3 ? std::stoull(argv[3]) : 1);
+    std::string bytes(file.data(), file.len());
+#ifdef LEXER_UTF8
+    std::vector<input_unit> units(bytes.begin(), bytes.end());
+#else
+    utf32::string text(bytes);
+    std::vector<input_unit> units(text.data(), text.data() + text.len());
+#endif
+    if (units.empty()) {
+        std::cerr << argv[1] << " is empty" << std::endl;
+        return 1;
+    }
+
+    std::vector<input_unit> edited = units;
+    if (!check_relex(edited, rounds, rng) || !check_push(units, rounds, rng)) {
+        return 1;
+    }
+    // the same text followed by a code point outside ascii that no rule
+    // matches, on utf-8 input the pieces then also split the units of the
+    // final ERROR
+    std::string tail = bytes + "\xe4\xb8\xad";
+#ifdef LEXER_UTF8
+    std::vector<input_unit> ending(tail.begin(), tail.end());
+#else
+    utf32::string decoded(tail);
+    std::vector<input_unit> ending(decoded.data(),
+                                   decoded.data() + decoded.len());
+#endif
+    return check_push(ending, rounds, rng) ? 0 : 1;
+}
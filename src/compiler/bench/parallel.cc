@@ -0,0 +1,89 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "parallel.hh"
+
+// lexes one large input with lexer::next_batch and with lex_parallel on a
+// growing number of threads, checking that every run finds the same tokens
+static bool same_tokens(token_buffer &a, token_buffer &b) {
+    if (a.size != b.size) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size; i++) {
+        if (a.kinds[i] != b.kinds[i] || a.starts[i] != b.starts[i] ||
+            a.lengths[i] != b.lengths[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char const *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <input> [repeat] [max threads]"
+                  << std::endl;
+        return 1;
+    }
+    mapped_file file(argv[1]);
+    size_t repeat = argc > 2 ? std::stoul(argv[2]) : 1;
+    std::string bytes;
+    for (size_t i = 0; i < repeat; i++) {
+        bytes.append(file.data(), file.len());
+    }
+#ifdef LEXER_UTF8
+    const input_unit *data = bytes.data();
+    size_t length = bytes.size();
+#else
+    utf32::string text(bytes);
+    const input_unit *data = text.data();
+    size_t length = text.len();
+#endif
+    double megabytes = bytes.size() / 1e6;
+    using clock = std::chrono::steady_clock;
+
+    lexer sequential{input::stream(bytes)};
+    token_buffer reference;
+    token_buffer batch;
+    double base = 0;
+    while (1) {
+        auto start = clock::now();
+        size_t count = sequential.next_batch(batch, 1 << 16);
+        base += std::chrono::duration<double>(clock::now() - start).count();
+        for (size_t i = 0; i < count; i++) {
+            reference.reserve(reference.size + 1);
+            reference.kinds[reference.size] = batch.kinds[i];
+            reference.starts[reference.size] = batch.starts[i];
+            reference.lengths[reference.size] = batch.lengths[i];
+            reference.size++;
+        }
+        if (count == 0 || batch.kinds[count - 1] == token::ERROR) {
+            break;
+        }
+    }
+    std::cout << "input: " << megabytes << " MB, " << reference.size
+              << " tokens" << std::endl
+              << "threads\tseconds\tMB/s\tspeedup" << std::endl
+              << "next\t" << base << "\t" << megabytes / base << "\t1"
+              << std::endl;
+
+    unsigned cores = argc > 3 ? std::stoul(argv[3])
+                              : std::thread::hardware_concurrency();
+    cores = std::max(1u, cores);
+    for (unsigned threads = 1; threads <= cores;
+         threads = threads < cores && threads * 2 > cores ? cores
+                                                          : threads * 2) {
+        auto start = clock::now();
+        token_buffer tokens = lex_parallel(data, length, threads);
+        double seconds =
+            std::chrono::duration<double>(clock::now() - start).count();
+        if (!same_tokens(tokens, reference)) {
+            std::cerr << "tokens differ from sequential lexing with "
+                      << threads << " threads" << std::endl;
+            return 1;
+        }
+        std::cout << threads << "\t" << seconds << "\t" << megabytes / seconds
+                  << "\t" << base / seconds << std::endl;
+    }
+    return 0;
+}
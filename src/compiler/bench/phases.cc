@@ -0,0 +1,240 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+
+#include "generator/lexer.hh"
+
+// times the phases of lexergen on generated grammars of growing size and
+// prints one tab separated line per grammar. every grammar is processed in
+// a child process, so its peak resident size is the one the generator
+// needed for it alone. powerset_s includes compressing the nfa alphabet,
+// create_full_dfa_s is the whole pipeline with keyword extraction and
+// generate_cpp_s writes the lexer for its result
+
+static std::string word(size_t i) {
+    // a distinct lowercase word for every number, at least two letters long
+    std::string text;
+    do {
+        text.push_back('a' + i % 26);
+        i /= 26;
+    } while (i != 0);
+    text.push_back('a' + text.size() % 26);
+    return text;
+}
+
+static std::string grammar(const std::string &family, size_t n) {
+    std::stringstream out;
+    if (family == "keywords") {
+        out << "IDENTIFIER [a-z_][a-z0-9_]*" << std::endl
+            << "SPACE [ \\t\\n]+";
+        for (size_t i = 0; i < n; i++) {
+            out << std::endl << "KW_" << i << " " << word(i);
+        }
+    } else if (family == "alternations") {
+        out << "SPACE [ \\t\\n]+" << std::endl << "WORD " << word(0);
+        for (size_t i = 1; i < n; i++) {
+            out << "|" << word(i);
+        }
+    } else if (family == "nested") {
+        std::string regex = "a";
+        for (size_t i = 0; i < n; i++) {
+            regex = "(" + regex + word(i) + ")" + (i % 2 == 0 ? "*" : "+");
+        }
+        out << "SPACE [ \\t\\n]+" << std::endl << "NESTED x" << regex;
+    } else if (family == "unicode") {
+        out << "SPACE [ \\t\\n]+";
+        for (size_t i = 0; i < n; i++) {
+            out << std::endl << "U_" << i << " " << word(i) << "(\\L|[0-9])*";
+        }
+    } else {
+        throw std::runtime_error("unknown grammar family: " + family);
+    }
+    return out.str();
+}
+
+struct phase_result {
+    double read_rules;
+    double alphabet;
+    double nfa;
+    double powerset;
+    double minimize;
+    double full_dfa;
+    double generate;
+    size_t alphabet_ranges;
+    size_t nfa_states;
+    size_t nfa_transitions;
+    size_t dfa_states;
+    size_t dfa_transitions;
+    size_t min_states;
+    size_t classes;
+};
+
+static size_t transitions(const automaton &machine) {
+    size_t count = 0;
+    for (size_t s = 0; s < machine.edges.size(); s++) {
+        count += machine.edges[s].size();
+    }
+    for (size_t s = 0; s < machine.epsilon.size(); s++) {
+        count += machine.epsilon[s].size();
+    }
+    return count;
+}
+
+static phase_result run_phases(const std::string &text,
+                               const std::string &out_dir) {
+    using clock = std::chrono::steady_clock;
+    auto seconds = [](clock::time_point since) {
+        return std::chrono::duration<double>(clock::now() - since).count();
+    };
+    phase_result result{};
+
+    auto start = clock::now();
+    std::istringstream in(text);
+    std::vector<rule> rules = read_rules(in);
+    result.read_rules = seconds(start);
+    std::vector<rule *> selected;
+    for (rule &r : rules) {
+        selected.push_back(&r);
+    }
+
+    start = clock::now();
+    std::vector<char_range> alphabet = rule_alphabet(selected);
+    result.alphabet = seconds(start);
+    result.alphabet_ranges = alphabet.size();
+
+    start = clock::now();
+    std::unordered_map<uint16_t, std::string> finals;
+    automaton nfa = rule_nfa(selected, alphabet, finals);
+    result.nfa = seconds(start);
+    result.nfa_states = nfa.states;
+    result.nfa_transitions = transitions(nfa);
+
+    start = clock::now();
+    std::unordered_map<uint16_t, uint16_t> final_mapping;
+    nfa.compress_alphabet();
+    auto [dfa, dead] = nfa.powerset(final_mapping, finals);
+    result.powerset = seconds(start);
+    result.dfa_states = dfa.states;
+    result.dfa_transitions = transitions(dfa);
+
+    start = clock::now();
+    auto [min_dfa, min_dead] = dfa.minimize(final_mapping, dead);
+    result.minimize = seconds(start);
+    result.min_states = min_dfa.states;
+
+    start = clock::now();
+    dfa_meta full = create_full_dfa(std::move(rules));
+    result.full_dfa = seconds(start);
+    result.classes = full.alphabet.size();
+
+    start = clock::now();
+    generate_cpp(out_dir + "/lexer.cc", full.machine, full.trap, full.names,
+                 full.final_mapping, full.alphabet, full.keywords,
+                 lexer_profile{});
+    result.generate = seconds(start);
+    return result;
+}
+
+static bool measure(const std::string &family, size_t n,
+                    const std::string &out_dir) {
+    // the child sends its result through a pipe, the parent adds the peak
+    // resident size from wait4
+    int channel[2];
+    if (pipe(channel) != 0) {
+        throw std::runtime_error("unable to create pipe");
+    }
+    std::cout.flush();
+    pid_t child = fork();
+    if (child < 0) {
+        throw std::runtime_error("unable to fork");
+    }
+    if (child == 0) {
+        close(channel[0]);
+        std::stringstream quiet;
+        std::cout.rdbuf(quiet.rdbuf());
+        phase_result result = run_phases(grammar(family, n), out_dir);
+        ssize_t written = write(channel[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(channel[1]);
+    phase_result result;
+    ssize_t got = read(channel[0], &result, sizeof(result));
+    close(channel[0]);
+    int status;
+    struct rusage usage;
+    wait4(child, &status, 0, &usage);
+    if (got != sizeof(result) || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        std::cerr << family << " " << n << ": generator failed" << std::endl;
+        return false;
+    }
+    std::cout << family << "\t" << n << "\t" << result.read_rules << "\t"
+              << result.alphabet << "\t" << result.nfa << "\t"
+              << result.powerset << "\t" << result.minimize << "\t"
+              << result.full_dfa << "\t" << result.generate << "\t"
+              << result.alphabet_ranges << "\t" << result.nfa_states << "\t"
+              << result.nfa_transitions << "\t" << result.dfa_states << "\t"
+              << result.dfa_transitions << "\t" << result.min_states << "\t"
+              << result.classes << "\t" << usage.ru_maxrss << std::endl;
+    return true;
+}
+
+int main(int argc, char const *argv[]) {
+    std::vector<std::string> families = {"keywords", "alternations",
+                                         "nested", "unicode"};
+    std::vector<size_t> sizes = {8, 16, 32, 64, 128, 256, 512};
+    std::string out_dir = std::filesystem::temp_directory_path().string();
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.starts_with("--family=")) {
+            families.clear();
+            std::stringstream names(arg.substr(9));
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                families.push_back(name);
+            }
+        } else if (arg.starts_with("--sizes=")) {
+            sizes.clear();
+            std::stringstream values(arg.substr(8));
+            std::string value;
+            while (std::getline(values, value, ',')) {
+                sizes.push_back(std::stoul(value));
+            }
+        } else if (arg.starts_with("--out=")) {
+            out_dir = arg.substr(6);
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--family=keywords,alternations,nested,unicode]"
+                         " [--sizes=n,...] [--out=dir]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    for (const std::string &family : families) {
+        try {
+            grammar(family, 1);
+        } catch (std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "# lexergen_phase_bench format=1" << std::endl
+              << "family\tsize\tread_rules_s\talphabet_s\tnfa_s\tpowerset_s\t"
+                 "minimize_s\tcreate_full_dfa_s\tgenerate_cpp_s\talphabet\t"
+                 "nfa_states\tnfa_transitions\tdfa_states\tdfa_transitions\t"
+                 "min_states\tclasses\tpeak_rss_kb"
+              << std::endl;
+    bool ok = true;
+    for (const std::string &family : families) {
+        for (size_t n : sizes) {
+            ok = measure(family, n, out_dir) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,514 @@
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+
+#include "lexer.hh"
+
+// lexes synthetic corpora with lexer::next and prints one tab separated
+// line per corpus. the first line names the format version and the
+// configuration, the second the columns. rates are taken from the median
+// run. a run times only the lexer::next loop, setting up the input stream,
+// which decodes it to utf-32 unless the lexer runs on utf-8, is timed on its
+// own as setup_s. with --counters every line ends with hardware counters
+// over the loops of the measured runs, per byte and per token, or - where
+// the counter isn't available
+
+#ifndef LEXER_BACKEND_NAME
+#define LEXER_BACKEND_NAME "unknown"
+#endif
+
+enum token_mix {
+    MIX_IDENTIFIER,
+    MIX_KEYWORD,
+    MIX_UNICODE,
+    MIX_NUMBER,
+    MIX_PUNCT,
+    MIX_SPACE,
+    MIX_COMMENT,
+    MIX_KINDS
+};
+
+struct corpus_spec {
+    std::string name;
+    double weights[MIX_KINDS];
+};
+
+static const corpus_spec corpora[] = {
+    {"identifiers", {8, 0, 0, 1, 2, 0, 0}},
+    {"whitespace", {2, 0, 0, 0, 1, 6, 0}},
+    {"keywords", {1, 8, 0, 0, 1, 0, 0}},
+    {"unicode", {2, 0, 6, 0, 1, 0, 0}},
+    {"code", {5, 3, 0, 1, 4, 2, 1}},
+};
+
+static const char *keywords[] = {
+    "fun",   "void",  "byte",  "short",  "int",   "long",
+    "float", "double", "if",   "else",   "while", "for",
+    "return", "break", "continue", "struct"};
+
+// letters outside ascii, all matched by \L
+static const char *letters[] = {"\xc3\xa9", "\xc3\x9f", "\xc3\xbc", "\xc3\xb1",
+                                "\xce\xbb", "\xce\xa9", "\xd0\x96", "\xd0\xb6",
+                                "\xe4\xb8\xad", "\xe6\x96\x87"};
+
+static const char ident_chars[] =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+static const char punct_chars[] = "(){};,.=<>+*/%!&|";
+static const char space_chars[] = "    \t\n";
+
+static std::string generate(const corpus_spec &spec, size_t size,
+                            uint64_t seed) {
+    // word like tokens are followed by a space so they never run together
+    std::mt19937_64 rng(seed);
+    std::discrete_distribution<int> pick(spec.weights,
+                                         spec.weights + MIX_KINDS);
+    std::string out;
+    out.reserve(size + 64);
+    while (out.size() < size) {
+        switch (pick(rng)) {
+            case MIX_IDENTIFIER: {
+                size_t length = 1 + rng() % 12;
+                out.push_back(ident_chars[rng() % 53]);
+                for (size_t i = 1; i < length; i++) {
+                    out.push_back(ident_chars[rng() % 63]);
+                }
+                out.push_back(' ');
+                break;
+            }
+            case MIX_KEYWORD:
+                out.append(keywords[rng() % 16]);
+                out.push_back(' ');
+                break;
+            case MIX_UNICODE: {
+                size_t length = 1 + rng() % 8;
+                for (size_t i = 0; i < length; i++) {
+                    if (rng() % 2 == 0) {
+                        out.append(letters[rng() % 10]);
+                    } else {
+                        out.push_back(ident_chars[rng() % 52]);
+                    }
+                }
+                out.push_back(' ');
+                break;
+            }
+            case MIX_NUMBER: {
+                size_t length = 1 + rng() % 8;
+                for (size_t i = 0; i < length; i++) {
+                    out.push_back('0' + rng() % 10);
+                }
+                out.push_back(' ');
+                break;
+            }
+            case MIX_PUNCT:
+                out.push_back(punct_chars[rng() % 17]);
+                break;
+            case MIX_SPACE: {
+                size_t length = 8 + rng() % 56;
+                for (size_t i = 0; i < length; i++) {
+                    out.push_back(space_chars[rng() % 6]);
+                }
+                break;
+            }
+            case MIX_COMMENT: {
+                size_t length = 10 + rng() % 60;
+                out.append("# ");
+                for (size_t i = 0; i < length; i++) {
+                    out.push_back(rng() % 6 == 0 ? ' '
+                                                 : ident_chars[rng() % 52]);
+                }
+                out.push_back('\n');
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+static size_t input_units(const std::string &text) {
+#ifdef LEXER_UTF8
+    return text.size();
+#else
+    return std::count_if(text.begin(), text.end(),
+                         [](char c) { return (c & 0xc0) != 0x80; });
+#endif
+}
+
+// lexes the whole input of l, returning the number of tokens before the
+// final ERROR. the ERROR has to be at the end of the input, the corpora are
+// valid
+static size_t lex(lexer &l, size_t *end) {
+    size_t count = 0;
+    while (l.next() != token::ERROR) {
+        count++;
+    }
+    *end = l.tk_start();
+    return count;
+}
+
+struct counter_spec {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+};
+
+#ifdef __linux__
+static const counter_spec counter_specs[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"l1i_misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1I | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+         PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {"l1d_misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+         PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {"task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+};
+#else
+static const counter_spec counter_specs[] = {
+    {"cycles", 0, 0},     {"instructions", 0, 0}, {"branch_misses", 0, 0},
+    {"l1i_misses", 0, 0}, {"l1d_misses", 0, 0},   {"task_clock_ns", 0, 0},
+};
+#endif
+static const size_t counter_count =
+    sizeof(counter_specs) / sizeof(counter_specs[0]);
+
+// counters of this thread in user space. the hardware counters are opened
+// as one group under cycles, so the kernel schedules them together and
+// ratios between them come from the same window even when it multiplexes.
+// when the group can't be opened every counter is opened on its own, and
+// any of them may be missing: no pmu in a virtual machine,
+// perf_event_paranoid or a kernel without perf events. a missing counter is
+// reported once and then left out
+class perf_counters {
+    int m_fds[counter_count];
+    // position of a counter in the group led by m_fds[0], -1 for a counter
+    // opened on its own
+    int m_slots[counter_count];
+    void control(unsigned long request);
+
+   public:
+    perf_counters();
+    ~perf_counters();
+    void reset();
+    void start();
+    void stop();
+    bool read(size_t counter, double *value);
+};
+
+#ifdef __linux__
+static int open_counter(const counter_spec &spec, int group,
+                        uint64_t read_format) {
+    // members of a group are enabled and disabled with their leader
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.disabled = group < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = read_format;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+perf_counters::perf_counters() {
+    for (size_t i = 0; i < counter_count; i++) {
+        this->m_fds[i] = -1;
+        this->m_slots[i] = -1;
+    }
+#ifdef __linux__
+    const uint64_t times =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    int leader = open_counter(counter_specs[0], -1, PERF_FORMAT_GROUP | times);
+    if (leader >= 0) {
+        this->m_fds[0] = leader;
+        this->m_slots[0] = 0;
+        for (size_t i = 1; i < counter_count &&
+                           counter_specs[i].type != PERF_TYPE_SOFTWARE;
+             i++) {
+            this->m_fds[i] = open_counter(counter_specs[i], leader, 0);
+            this->m_slots[i] = i;
+            if (this->m_fds[i] < 0) {
+                for (size_t k = 0; k <= i; k++) {
+                    if (this->m_fds[k] >= 0) {
+                        close(this->m_fds[k]);
+                    }
+                    this->m_fds[k] = -1;
+                    this->m_slots[k] = -1;
+                }
+                break;
+            }
+        }
+    }
+    for (size_t i = 0; i < counter_count; i++) {
+        if (this->m_fds[i] >= 0) {
+            continue;
+        }
+        this->m_fds[i] = open_counter(counter_specs[i], -1, times);
+        if (this->m_fds[i] < 0) {
+            std::cerr << "counter " << counter_specs[i].name
+                      << " unavailable: " << std::strerror(errno)
+                      << std::endl;
+        }
+    }
+#else
+    for (size_t i = 0; i < counter_count; i++) {
+        std::cerr << "counter " << counter_specs[i].name
+                  << " unavailable: perf events need linux" << std::endl;
+    }
+#endif
+}
+
+perf_counters::~perf_counters() {
+#ifdef __linux__
+    for (int fd : this->m_fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+void perf_counters::control(unsigned long request) {
+    // the group is controlled through its leader, members are skipped
+#ifdef __linux__
+    for (size_t i = 0; i < counter_count; i++) {
+        if (this->m_fds[i] >= 0 && this->m_slots[i] <= 0) {
+            ioctl(this->m_fds[i], request,
+                  this->m_slots[i] == 0 ? PERF_IOC_FLAG_GROUP : 0);
+        }
+    }
+#endif
+}
+
+void perf_counters::reset() {
+#ifdef __linux__
+    this->control(PERF_EVENT_IOC_RESET);
+#endif
+}
+
+void perf_counters::start() {
+#ifdef __linux__
+    this->control(PERF_EVENT_IOC_ENABLE);
+#endif
+}
+
+void perf_counters::stop() {
+#ifdef __linux__
+    this->control(PERF_EVENT_IOC_DISABLE);
+#endif
+}
+
+bool perf_counters::read(size_t counter, double *value) {
+    // the kernel multiplexes counters when there are more than the pmu
+    // has, the count is then scaled up to the whole time it was enabled.
+    // a group reads as its size and times followed by one value per member
+#ifdef __linux__
+    int fd = this->m_fds[counter];
+    int slot = this->m_slots[counter];
+    uint64_t data[3 + counter_count];
+    if (slot >= 0) {
+        ssize_t size = ::read(this->m_fds[0], data, sizeof(data));
+        if (size < static_cast<ssize_t>(3 * sizeof(uint64_t)) ||
+            data[0] <= static_cast<uint64_t>(slot) || data[2] == 0) {
+            return false;
+        }
+        *value = static_cast<double>(data[3 + slot]) * data[1] / data[2];
+        return true;
+    }
+    if (fd < 0 || ::read(fd, data, 3 * sizeof(uint64_t)) !=
+                      static_cast<ssize_t>(3 * sizeof(uint64_t)) ||
+        data[2] == 0) {
+        return false;
+    }
+    *value = static_cast<double>(data[0]) * data[1] / data[2];
+    return true;
+#else
+    return false;
+#endif
+}
+
+struct run_stats {
+    double min;
+    double median;
+    double mean;
+    double stddev;
+};
+
+static run_stats summarize(std::vector<double> seconds) {
+    std::sort(seconds.begin(), seconds.end());
+    run_stats stats{seconds.front(), 0, 0, 0};
+    size_t n = seconds.size();
+    stats.median = n % 2 == 1 ? seconds[n / 2]
+                              : (seconds[n / 2 - 1] + seconds[n / 2]) / 2;
+    for (double s : seconds) {
+        stats.mean += s;
+    }
+    stats.mean /= n;
+    for (double s : seconds) {
+        stats.stddev += (s - stats.mean) * (s - stats.mean);
+    }
+    stats.stddev = n > 1 ? std::sqrt(stats.stddev / (n - 1)) : 0;
+    return stats;
+}
+
+static int usage(const char *name) {
+    std::cerr << "usage: " << name
+              << " [--size=MB] [--warmup=n] [--repeat=n] [--seed=n]"
+                 " [--corpus=name,...] [--weights=w,w,w,w,w,w,w]"
+                 " [--counters]"
+              << std::endl
+              << "corpora:";
+    for (const corpus_spec &spec : corpora) {
+        std::cerr << " " << spec.name;
+    }
+    std::cerr << std::endl
+              << "weights: identifier keyword unicode number punct space "
+                 "comment"
+              << std::endl;
+    return 1;
+}
+
+int main(int argc, char const *argv[]) {
+    double megabytes = 16;
+    size_t warmup = 2;
+    size_t repeat = 10;
+    uint64_t seed = 1;
+    bool counters = false;
+    std::vector<corpus_spec> selected(std::begin(corpora), std::end(corpora));
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.compare(0, 7, "--size=") == 0) {
+            megabytes = std::stod(arg.substr(7));
+        } else if (arg.compare(0, 9, "--warmup=") == 0) {
+            warmup = std::stoul(arg.substr(9));
+        } else if (arg.compare(0, 9, "--repeat=") == 0) {
+            repeat = std::max(1ul, std::stoul(arg.substr(9)));
+        } else if (arg.compare(0, 7, "--seed=") == 0) {
+            seed = std::stoull(arg.substr(7));
+        } else if (arg.compare(0, 9, "--corpus=") == 0) {
+            selected.clear();
+            std::stringstream names(arg.substr(9));
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                auto found = std::find_if(
+                    std::begin(corpora), std::end(corpora),
+                    [&](const corpus_spec &spec) { return spec.name == name; });
+                if (found == std::end(corpora)) {
+                    std::cerr << "unknown corpus: " << name << std::endl;
+                    return usage(argv[0]);
+                }
+                selected.push_back(*found);
+            }
+        } else if (arg.compare(0, 10, "--weights=") == 0) {
+            corpus_spec custom{"custom", {}};
+            std::stringstream weights(arg.substr(10));
+            std::string weight;
+            for (int k = 0; k < MIX_KINDS; k++) {
+                if (!std::getline(weights, weight, ',')) {
+                    return usage(argv[0]);
+                }
+                custom.weights[k] = std::stod(weight);
+            }
+            selected.assign(1, custom);
+        } else if (arg == "--counters") {
+            counters = true;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+#ifdef LEXER_UTF8
+    bool utf8 = true;
+#else
+    bool utf8 = false;
+#endif
+    std::unique_ptr<perf_counters> perf;
+    if (counters) {
+        perf = std::make_unique<perf_counters>();
+    }
+    std::cout << "# lexer_throughput_bench format=2 backend="
+              << LEXER_BACKEND_NAME << " utf8=" << utf8
+              << " warmup=" << warmup << " repeat=" << repeat
+              << " seed=" << seed << " counters=" << counters << std::endl
+              << "corpus\tbytes\ttokens\tmin_s\tmedian_s\tmean_s\tstddev_s\t"
+                 "mb_per_s\ttokens_per_s\tns_per_token\tsetup_s";
+    if (perf) {
+        for (const counter_spec &spec : counter_specs) {
+            std::cout << "\t" << spec.name << "_per_byte\t" << spec.name
+                      << "_per_token";
+        }
+    }
+    std::cout << std::endl;
+
+    using clock = std::chrono::steady_clock;
+    for (const corpus_spec &spec : selected) {
+        std::string text =
+            generate(spec, static_cast<size_t>(megabytes * 1e6), seed);
+        size_t units = input_units(text);
+        size_t end = 0;
+        size_t tokens = 0;
+        std::vector<double> seconds, setup;
+        if (perf) {
+            perf->reset();
+        }
+        for (size_t run = 0; run < warmup + repeat; run++) {
+            bool measured = run >= warmup;
+            auto prepare = clock::now();
+            lexer l{input::stream(text)};
+            double prepared =
+                std::chrono::duration<double>(clock::now() - prepare).count();
+            if (perf && measured) {
+                perf->start();
+            }
+            auto start = clock::now();
+            tokens = lex(l, &end);
+            double elapsed =
+                std::chrono::duration<double>(clock::now() - start).count();
+            if (perf && measured) {
+                perf->stop();
+            }
+            if (end != units) {
+                std::cerr << spec.name << ": lexing failed at " << end
+                          << " of " << units << " units" << std::endl;
+                return 1;
+            }
+            if (measured) {
+                seconds.push_back(elapsed);
+                setup.push_back(prepared);
+            }
+        }
+        run_stats stats = summarize(seconds);
+        std::cout << spec.name << "\t" << text.size() << "\t" << tokens
+                  << "\t" << stats.min << "\t" << stats.median << "\t"
+                  << stats.mean << "\t" << stats.stddev << "\t"
+                  << text.size() / 1e6 / stats.median << "\t"
+                  << tokens / stats.median << "\t"
+                  << stats.median * 1e9 / tokens << "\t"
+                  << summarize(setup).median;
+        for (size_t i = 0; perf && i < counter_count; i++) {
+            double value;
+            if (perf->read(i, &value)) {
+                std::cout << "\t" << value / (text.size() * repeat) << "\t"
+                          << value / (tokens * repeat);
+            } else {
+                std::cout << "\t-\t-";
+            }
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
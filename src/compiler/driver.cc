@@ -0,0 +1,167 @@
+#include "driver.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+std::vector<std::string> collect_files(const std::vector<std::string> &args) {
+    std::vector<std::string> files;
+    for (const std::string &arg : args) {
+        if (arg.size() > 1 && arg[0] == '@') {
+            std::ifstream list(arg.substr(1));
+            if (!list) {
+                throw std::runtime_error("unable to open file list: " +
+                                         arg.substr(1));
+            }
+            std::string line;
+            while (std::getline(list, line)) {
+                if (!line.empty()) {
+                    files.push_back(line);
+                }
+            }
+        } else if (std::filesystem::is_directory(arg)) {
+            std::vector<std::string> found;
+            for (auto &entry :
+                 std::filesystem::recursive_directory_iterator(arg)) {
+                if (entry.is_regular_file() &&
+                    entry.path().extension() == ".sp") {
+                    found.push_back(entry.path().string());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else {
+            files.push_back(arg);
+        }
+    }
+    return files;
+}
+
+// the jobs of one worker. the owner takes the largest file left from the
+// front, idle workers steal the smallest ones from the back
+class job_queue {
+    std::mutex m_lock;
+    std::deque<size_t> m_jobs;
+
+   public:
+    void push(size_t job);
+    bool take(size_t *job);
+    bool steal(size_t *job);
+};
+
+void job_queue::push(size_t job) { this->m_jobs.push_back(job); }
+
+bool job_queue::take(size_t *job) {
+    std::lock_guard<std::mutex> guard(this->m_lock);
+    if (this->m_jobs.empty()) {
+        return false;
+    }
+    *job = this->m_jobs.front();
+    this->m_jobs.pop_front();
+    return true;
+}
+
+bool job_queue::steal(size_t *job) {
+    std::lock_guard<std::mutex> guard(this->m_lock);
+    if (this->m_jobs.empty()) {
+        return false;
+    }
+    *job = this->m_jobs.back();
+    this->m_jobs.pop_back();
+    return true;
+}
+
+// lexes one file with the lexer and token buffer of the calling worker,
+// which keep their storage from one file to the next
+static void lex_file(lex_result &result, bool dump, lexer &file_lexer,
+                     token_buffer &tokens) {
+    auto start = std::chrono::steady_clock::now();
+    try {
+        mapped_file file(result.path);
+        result.bytes = file.len();
+        file_lexer.reset(std::move(file));
+        token last;
+        if (dump) {
+            std::ostringstream out;
+            while ((last = file_lexer.next()) != token::ERROR) {
+                auto text = file_lexer.tk_str();
+                position p = file_lexer.tk_position();
+                out << p.line << ":" << p.column << " " << last << ": '"
+                    << text << "'" << std::endl;
+                result.tokens++;
+            }
+            result.dump = out.str();
+        } else {
+            do {
+                size_t count = file_lexer.next_batch(tokens, 1 << 12);
+                last = tokens.kinds[count - 1];
+                result.tokens += count - (last == token::ERROR);
+            } while (last != token::ERROR);
+        }
+        if (!file_lexer.finished()) {
+            position p = file_lexer.tk_position();
+            result.error = "invalid token at " + std::to_string(p.line) +
+                           ":" + std::to_string(p.column);
+        }
+    } catch (std::exception &e) {
+        result.error = e.what();
+    }
+    // unmaps the file, the lexer's buffers stay for the next one
+    file_lexer.reset(mapped_file());
+    result.seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+}
+
+std::vector<lex_result> lex_files(const std::vector<std::string> &paths,
+                                  unsigned *threads_used, bool dump) {
+    std::vector<lex_result> results(paths.size());
+    std::vector<std::pair<uintmax_t, size_t>> by_size;
+    for (size_t i = 0; i < paths.size(); i++) {
+        results[i].path = paths[i];
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(paths[i], error);
+        by_size.push_back({error ? 0 : size, i});
+    }
+    std::sort(by_size.begin(), by_size.end(), std::greater<>());
+
+    // largest files first, dealt round robin so every worker starts on one
+    // of the big ones
+    unsigned threads =
+        std::max(1u, std::min<unsigned>(*threads_used, paths.size()));
+    *threads_used = threads;
+    std::vector<job_queue> queues(threads);
+    for (size_t i = 0; i < by_size.size(); i++) {
+        queues[i % threads].push(by_size[i].second);
+    }
+    auto work = [&](unsigned self) {
+        lexer file_lexer{mapped_file()};
+        token_buffer tokens;
+        size_t job;
+        while (1) {
+            bool found = queues[self].take(&job);
+            for (unsigned k = 1; !found && k < threads; k++) {
+                found = queues[(self + k) % threads].steal(&job);
+            }
+            if (!found) {
+                return;
+            }
+            lex_file(results[job], dump, file_lexer, tokens);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned k = 1; k < threads; k++) {
+        workers.emplace_back(work, k);
+    }
+    work(0);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return results;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "lexer.hh"
+
+struct lex_result {
+    std::string path;
+    size_t bytes = 0;
+    size_t tokens = 0;
+    double seconds = 0;
+    // empty when the whole file was lexed
+    std::string error;
+    // the tokens, one per line, when dumping was asked for
+    std::string dump;
+};
+
+// expands directories to the .sp files below them and @list arguments to
+// the paths listed in the file, one per line
+std::vector<std::string> collect_files(const std::vector<std::string> &args);
+
+// lexes every file on a pool of at most *threads threads and returns the
+// results in the order of the paths. *threads is set to the number of
+// threads actually used, never more than there are files
+std::vector<lex_result> lex_files(const std::vector<std::string> &paths,
+                                  unsigned *threads, bool dump);
@@ -232,4 +232,32 @@ void ast_cat::construct_alphabet(std::vector<chr_t> &alphabet) {
 
 void ast_rep::construct_alphabet(std::vector<chr_t> &alphabet) {
     this->child->construct_alphabet(alphabet);
-}
\ No newline at end of file
+}
+
+bool ast::literal(std::vector<chr_t> &) { return false; }
+
+bool ast_set::literal(std::vector<chr_t> &text) {
+    if (this->negate || this->ranges.size() != 1) {
+        return false;
+    }
+    chr_t start = this->ranges[0] >> 32;
+    chr_t end = this->ranges[0];
+    if (end != start + 1) {
+        return false;
+    }
+    text.push_back(start);
+    return true;
+}
+
+bool ast_cat::literal(std::vector<chr_t> &text) {
+    for (auto &child : this->children) {
+        if (!child->literal(text)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ast_alt::literal(std::vector<chr_t> &text) {
+    return this->children.size() == 1 && this->children[0]->literal(text);
+}
@@ -8,7 +8,7 @@
 typedef uint32_t chr_t;
 typedef uint64_t char_range;
 
-#define CHAR_RANGE(start, end) (((uint64_t)start << 32) | end)
+#define CHAR_RANGE(start, end) (((uint64_t)(start) << 32) | (end))
 
 struct autopart {
     uint16_t start;
@@ -30,6 +30,8 @@ class ast {
                                      std::unordered_map<uint16_t, std::string> &finals,
                                      uint16_t *state_count) = 0;
     virtual void construct_alphabet(std::vector<chr_t> &alphabet) = 0;
+    // appends the only string the expression matches, if there is just one
+    virtual bool literal(std::vector<chr_t> &text);
     virtual std::ostream &print(std::ostream &stream);
 };
 
@@ -46,6 +48,7 @@ class ast_set : public ast {
                                      std::unordered_map<uint16_t, std::string> &finals,
                                      uint16_t *state_count);
     virtual void construct_alphabet(std::vector<chr_t> &alphabet);
+    virtual bool literal(std::vector<chr_t> &text);
     virtual ~ast_set();
     virtual std::ostream &print(std::ostream &stream);
 };
@@ -61,6 +64,7 @@ class ast_cat : public ast {
                                      std::unordered_map<uint16_t, std::string> &finals,
                                      uint16_t *state_count);
     virtual void construct_alphabet(std::vector<chr_t> &alphabet);
+    virtual bool literal(std::vector<chr_t> &text);
     virtual ~ast_cat();
     virtual std::ostream &print(std::ostream &stream);
 };
@@ -76,6 +80,7 @@ class ast_alt : public ast {
                                      std::unordered_map<uint16_t, std::string> &finals,
                                      uint16_t *state_count);
     virtual void construct_alphabet(std::vector<chr_t> &alphabet);
+    virtual bool literal(std::vector<chr_t> &text);
     virtual ~ast_alt();
     virtual std::ostream &print(std::ostream &stream);
 };
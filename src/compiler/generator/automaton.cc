@@ -1,6 +1,14 @@
 #include "automaton.hh"
 
-std::set<uint16_t> intersect_set(std::unordered_set<uint16_t> &set_a,
+size_t state_set_hash::operator()(const state_set &set) const {
+    size_t hash = 0xcbf29ce484222325;
+    for (uint16_t state : set) {
+        hash = (hash ^ state) * 0x100000001b3;
+    }
+    return hash;
+}
+
+std::set<uint16_t> intersect_set(const state_set &set_a,
                                  std::unordered_set<uint16_t> &set_b) {
     std::set<uint16_t> output;
     for (uint16_t el : set_a) {
@@ -15,47 +23,159 @@ automaton::automaton(uint16_t states, std::unordered_set<uint16_t> finals,
                      uint32_t alphabet, uint16_t initial)
     : states(states), initial(initial), alphabet(alphabet), finals(finals) {}
 
-void automaton::connect(uint16_t start, uint16_t end, uint32_t input) {
-    uint64_t id = ((uint64_t)start) << 48 | ((uint64_t)end) << 32 | input;
-    this->transition[id] = end;
+bool operator<(const edge &a, const edge &b) {
+    return a.input < b.input || (a.input == b.input && a.end < b.end);
 }
 
-void automaton::_epsilon_closure_rec(std::unordered_set<uint16_t> &closure,
-                                     uint16_t state) {
-    closure.insert(state);
-    uint64_t id = ((uint64_t)state) << 48;
-    for (auto &pair : this->transition) {
-        if ((pair.first & 0xffff0000ffffffff) == id) {
-            if (!closure.contains(pair.second)) {
-                automaton::_epsilon_closure_rec(closure, pair.second);
-            }
+void automaton::connect(uint16_t start, uint16_t end, uint32_t input) {
+    if (start >= this->edges.size()) {
+        this->edges.resize(start + 1);
+        this->epsilon.resize(start + 1);
+    }
+    if (input == 0) {
+        auto &targets = this->epsilon[start];
+        auto pos = std::lower_bound(targets.begin(), targets.end(), end);
+        if (pos == targets.end() || *pos != end) {
+            targets.insert(pos, end);
+        }
+    } else {
+        auto &targets = this->edges[start];
+        edge e{input, end};
+        auto pos = std::lower_bound(targets.begin(), targets.end(), e);
+        if (pos == targets.end() || pos->input != input || pos->end != end) {
+            targets.insert(pos, e);
         }
     }
 }
 
-std::unordered_set<uint16_t> automaton::epsilon_closure(uint16_t state) {
-    std::unordered_set<uint16_t> result;
-    this->_epsilon_closure_rec(result, state);
-    return result;
+void automaton::compute_closures() {
+    // Tarjan's algorithm over the epsilon edges, run with an explicit stack.
+    // Components are completed in reverse topological order, so the closure
+    // of a component is its own members plus the already known closures of
+    // the components it reaches.
+    const uint32_t unvisited = UINT32_MAX;
+    std::vector<uint32_t> index(this->states, unvisited);
+    std::vector<uint32_t> low(this->states, 0);
+    std::vector<bool> on_stack(this->states, false);
+    std::vector<uint16_t> component_stack;
+    std::vector<std::pair<uint16_t, uint32_t>> call_stack;
+    std::vector<uint32_t> mark(this->states, unvisited);
+    uint32_t counter = 0;
+    uint32_t components = 0;
+    this->closures.assign(this->states, state_set{});
+
+    auto successors = [this](uint16_t state) -> const std::vector<uint16_t> & {
+        static const std::vector<uint16_t> none;
+        return state < this->epsilon.size() ? this->epsilon[state] : none;
+    };
+
+    for (uint32_t root = 0; root < this->states; root++) {
+        if (index[root] != unvisited) {
+            continue;
+        }
+        call_stack.emplace_back(root, 0);
+        while (!call_stack.empty()) {
+            auto &[state, next_edge] = call_stack.back();
+            if (next_edge == 0 && index[state] == unvisited) {
+                index[state] = low[state] = counter++;
+                component_stack.push_back(state);
+                on_stack[state] = true;
+            }
+            auto &targets = successors(state);
+            if (next_edge < targets.size()) {
+                uint16_t target = targets[next_edge++];
+                if (index[target] == unvisited) {
+                    call_stack.emplace_back(target, 0);
+                } else if (on_stack[target]) {
+                    low[state] = std::min(low[state], index[target]);
+                }
+                continue;
+            }
+            uint16_t done = state;
+            call_stack.pop_back();
+            if (!call_stack.empty()) {
+                uint16_t parent = call_stack.back().first;
+                low[parent] = std::min(low[parent], low[done]);
+            }
+            if (low[done] != index[done]) {
+                continue;
+            }
+            size_t first = component_stack.size();
+            do {
+                first--;
+            } while (component_stack[first] != done);
+            state_set closure;
+            for (size_t i = first; i < component_stack.size(); i++) {
+                mark[component_stack[i]] = components;
+                closure.push_back(component_stack[i]);
+            }
+            for (size_t i = first; i < component_stack.size(); i++) {
+                for (uint16_t target : successors(component_stack[i])) {
+                    for (uint16_t reached : this->closures[target]) {
+                        if (mark[reached] != components) {
+                            mark[reached] = components;
+                            closure.push_back(reached);
+                        }
+                    }
+                }
+            }
+            std::sort(closure.begin(), closure.end());
+            for (size_t i = first; i < component_stack.size(); i++) {
+                on_stack[component_stack[i]] = false;
+                this->closures[component_stack[i]] = closure;
+            }
+            component_stack.resize(first);
+            components++;
+        }
+    }
 }
 
-std::unordered_set<uint16_t> automaton::input_closure(
-    std::unordered_set<uint16_t> &state_e_closure, uint32_t input) {
-    std::unordered_set<uint16_t> result;
+state_set automaton::input_closure(const state_set &state_e_closure,
+                                   uint32_t input) {
+    state_set result;
     for (uint16_t state : state_e_closure) {
-        uint64_t id = ((uint64_t)state) << 48 | input;
-        for (auto &pair : this->transition) {
-            if ((pair.first & 0xffff0000ffffffff) == id) {
-                this->_epsilon_closure_rec(result, pair.second);
-            }
+        if (state >= this->edges.size()) {
+            continue;
+        }
+        auto &targets = this->edges[state];
+        auto pos = std::lower_bound(targets.begin(), targets.end(),
+                                    edge{input, 0});
+        for (; pos != targets.end() && pos->input == input; pos++) {
+            auto &closure = this->closures[pos->end];
+            result.insert(result.end(), closure.begin(), closure.end());
         }
     }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
     return result;
 }
 
 uint16_t automaton::get(uint16_t start, uint16_t end, uint32_t input) {
-    uint64_t id = ((uint64_t)start) << 48 | ((uint64_t)end) << 32 | input;
-    return this->transition[id];
+    if (start >= this->edges.size()) {
+        return 0;
+    }
+    if (input == 0) {
+        auto &targets = this->epsilon[start];
+        return std::binary_search(targets.begin(), targets.end(), end) ? end
+                                                                       : 0;
+    }
+    auto &targets = this->edges[start];
+    return std::binary_search(targets.begin(), targets.end(), edge{input, end})
+               ? end
+               : 0;
+}
+
+uint16_t automaton::step(uint16_t start, uint32_t input) const {
+    if (start >= this->edges.size()) {
+        return this->states;
+    }
+    auto &targets = this->edges[start];
+    auto pos =
+        std::lower_bound(targets.begin(), targets.end(), edge{input, 0});
+    if (pos == targets.end() || pos->input != input) {
+        return this->states;
+    }
+    return pos->end;
 }
 
 std::ostream &operator<<(std::ostream &stream, const automaton &el) {
@@ -65,56 +185,62 @@ std::ostream &operator<<(std::ostream &stream, const automaton &el) {
         stream << state + 1 << " ";
     }
     stream << "}, connections=[ ";
-    for (auto &pair : el.transition) {
-        uint16_t start = pair.first >> 48;
-        uint16_t end = pair.second;
-        uint32_t input = pair.first;
-        stream << "(" << start + 1 << ")--[" << input - 1 << "]->(" << end + 1
-               << ") ";
+    for (size_t start = 0; start < el.edges.size(); start++) {
+        for (uint16_t end : el.epsilon[start]) {
+            stream << "(" << start + 1 << ")--[-1]->(" << end + 1 << ") ";
+        }
+        for (const edge &e : el.edges[start]) {
+            stream << "(" << start + 1 << ")--[" << e.input - 1 << "]->("
+                   << e.end + 1 << ") ";
+        }
     }
     stream << "])";
     return stream;
 }
 
-void automaton::find_state_sets(
-    std::vector<std::unordered_set<uint16_t>> &state_sets,
-    std::unordered_map<uint64_t, uint16_t> &new_transition,
-    std::unordered_set<uint16_t> &origin) {
-    if (std::find(state_sets.begin(), state_sets.end(), origin) ==
-        state_sets.end()) {
-        state_sets.push_back(origin);
-        for (uint32_t input = 1; input <= this->alphabet; input++) {
-            auto closure = this->input_closure(origin, input);
-            this->find_state_sets(state_sets, new_transition, closure);
-
-            uint16_t origin_id =
-                std::find(state_sets.begin(), state_sets.end(), origin) -
-                state_sets.begin();
-            uint16_t closure_id =
-                std::find(state_sets.begin(), state_sets.end(), closure) -
-                state_sets.begin();
-            uint64_t id = ((uint64_t)origin_id) << 48 |
-                          ((uint64_t)closure_id) << 32 | input;
-            new_transition[id] = closure_id;
-        }
-    }
-}
-
 std::pair<automaton, uint16_t> automaton::powerset(
     std::unordered_map<uint16_t, uint16_t> &final_mapping,
     const std::unordered_map<uint16_t, std::string> &names) {
-    std::vector<std::unordered_set<uint16_t>> state_sets;
-    std::unordered_map<uint64_t, uint16_t> new_transition;
-    auto initial_closure = this->epsilon_closure(this->initial);
-    this->find_state_sets(state_sets, new_transition, initial_closure);
+    std::vector<state_set> state_sets;
+    std::unordered_map<state_set, uint16_t, state_set_hash> state_ids;
+    automaton resulting(0, std::unordered_set<uint16_t>{}, this->alphabet, 0);
+    this->compute_closures();
+
+    // subsets are numbered in the order they are discovered and expanded
+    // in that same order, so the transitions of every dfa state are
+    // connected before those of the next one
+    auto find_state_set = [&](state_set &&set) -> uint16_t {
+        auto known = state_ids.find(set);
+        if (known != state_ids.end()) {
+            return known->second;
+        }
+        // the last id is left free for the trap state, see below
+        if (state_sets.size() >= UINT16_MAX) {
+            throw std::runtime_error("dfa exceeds 65535 states");
+        }
+        uint16_t id = state_sets.size();
+        state_ids.emplace(set, id);
+        state_sets.emplace_back(std::move(set));
+        if (state_sets.size() % 4096 == 0) {
+            std::cout << "subset construction: " << state_sets.size()
+                      << " dfa states" << std::endl;
+        }
+        return id;
+    };
+    resulting.initial =
+        find_state_set(state_set(this->closures[this->initial]));
+    for (size_t origin_id = 0; origin_id < state_sets.size(); origin_id++) {
+        for (uint32_t input = 1; input <= this->alphabet; input++) {
+            uint16_t closure_id = find_state_set(
+                this->input_closure(state_sets[origin_id], input));
+            resulting.connect(origin_id, closure_id, input);
+        }
+    }
     std::vector<uint16_t> new_finals;
-    for (std::unordered_set<uint16_t> &state_set : state_sets) {
+    for (uint16_t state = 0; state < state_sets.size(); state++) {
         std::set<uint16_t> tmp_finals_inters =
-            intersect_set(state_set, this->finals);
+            intersect_set(state_sets[state], this->finals);
         if (tmp_finals_inters.size() > 0) {
-            uint16_t state =
-                std::find(state_sets.begin(), state_sets.end(), state_set) -
-                state_sets.begin();
             new_finals.push_back(state);
             for (uint16_t orig_final : tmp_finals_inters) {
                 auto &mapping = final_mapping[state];
@@ -127,20 +253,216 @@ std::pair<automaton, uint16_t> automaton::powerset(
             }
         }
     }
-    automaton resulting(
-        state_sets.size(),
-        std::unordered_set<uint16_t>(new_finals.begin(), new_finals.end()),
-        this->alphabet,
-        std::find(state_sets.begin(), state_sets.end(), initial_closure) -
-            state_sets.begin());
-    for (auto &pair : new_transition) {
-        uint16_t start = pair.first >> 48;
-        uint16_t end = pair.first >> 32;
-        uint32_t input = pair.first;
-        resulting.connect(start, end, input);
-    }
-    return std::make_pair(resulting,
-                          std::find(state_sets.begin(), state_sets.end(),
-                                    std::unordered_set<uint16_t>{}) -
-                              state_sets.begin());
-}
\ No newline at end of file
+    resulting.states = state_sets.size();
+    resulting.finals =
+        std::unordered_set<uint16_t>(new_finals.begin(), new_finals.end());
+    auto trap = state_ids.find(state_set{});
+    return std::make_pair(resulting, trap != state_ids.end()
+                                         ? trap->second
+                                         : (uint16_t)state_sets.size());
+}
+
+std::vector<uint32_t> automaton::compress_alphabet() {
+    // symbols that lead every state to the same targets can't be told apart
+    // by the automaton, so they are merged into one input class. classes are
+    // numbered by their first symbol, the returned vector maps every old
+    // symbol to its class and keeps 0 for epsilon
+    std::vector<std::vector<uint32_t>> columns(this->alphabet + 1);
+    for (size_t start = 0; start < this->edges.size(); start++) {
+        for (const edge &e : this->edges[start]) {
+            columns[e.input].push_back(start << 16 | e.end);
+        }
+    }
+    std::vector<uint32_t> classes(this->alphabet + 1, 0);
+    std::map<std::vector<uint32_t>, uint32_t> known_columns;
+    for (uint32_t input = 1; input <= this->alphabet; input++) {
+        auto known =
+            known_columns.emplace(columns[input], known_columns.size() + 1);
+        classes[input] = known.first->second;
+    }
+    for (auto &targets : this->edges) {
+        for (edge &e : targets) {
+            e.input = classes[e.input];
+        }
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end(),
+                                  [](const edge &a, const edge &b) {
+                                      return a.input == b.input &&
+                                             a.end == b.end;
+                                  }),
+                      targets.end());
+    }
+    this->alphabet = known_columns.size();
+    return classes;
+}
+
+std::pair<automaton, uint16_t> automaton::minimize(
+    std::unordered_map<uint16_t, uint16_t> &final_mapping, uint16_t trap) {
+    // Hopcroft partition refinement over the complete transition table of a
+    // dfa produced by powerset. States start out grouped by the token they
+    // accept, so two states only merge if they report the same result.
+    size_t state_count = this->states;
+    size_t symbols = this->alphabet;
+    std::vector<uint16_t> delta(state_count * symbols, trap);
+    for (size_t start = 0; start < this->edges.size(); start++) {
+        for (const edge &e : this->edges[start]) {
+            delta[start * symbols + e.input - 1] = e.end;
+        }
+    }
+
+    // predecessors of every (symbol, state) pair, stored contiguously
+    std::vector<uint32_t> pred_start(symbols * state_count + 1, 0);
+    for (size_t q = 0; q < state_count; q++) {
+        for (size_t a = 0; a < symbols; a++) {
+            uint16_t target = delta[q * symbols + a];
+            if (target < state_count) {
+                pred_start[a * state_count + target + 1]++;
+            }
+        }
+    }
+    for (size_t i = 1; i < pred_start.size(); i++) {
+        pred_start[i] += pred_start[i - 1];
+    }
+    std::vector<uint16_t> preds(pred_start.back());
+    std::vector<uint32_t> pred_fill(pred_start.begin(), pred_start.end() - 1);
+    for (size_t q = 0; q < state_count; q++) {
+        for (size_t a = 0; a < symbols; a++) {
+            uint16_t target = delta[q * symbols + a];
+            if (target < state_count) {
+                preds[pred_fill[a * state_count + target]++] = q;
+            }
+        }
+    }
+
+    struct block {
+        uint32_t start, end, marked;
+    };
+    std::vector<block> blocks;
+    std::vector<uint16_t> elements;
+    std::vector<uint32_t> location(state_count);
+    std::vector<uint32_t> block_of(state_count);
+
+    std::map<uint16_t, std::vector<uint16_t>> initial_partition;
+    for (uint16_t q = 0; q < state_count; q++) {
+        auto mapping = final_mapping.find(q);
+        initial_partition[mapping == final_mapping.end() ? 0 : mapping->second]
+            .push_back(q);
+    }
+    for (auto &pair : initial_partition) {
+        uint32_t start = elements.size();
+        for (uint16_t q : pair.second) {
+            location[q] = elements.size();
+            block_of[q] = blocks.size();
+            elements.push_back(q);
+        }
+        blocks.push_back({start, (uint32_t)elements.size(), 0});
+    }
+
+    std::vector<uint32_t> worklist;
+    std::vector<bool> in_worklist(blocks.size(), false);
+    size_t largest = 0;
+    for (size_t b = 1; b < blocks.size(); b++) {
+        if (blocks[b].end - blocks[b].start >
+            blocks[largest].end - blocks[largest].start) {
+            largest = b;
+        }
+    }
+    for (size_t b = 0; b < blocks.size(); b++) {
+        if (b != largest) {
+            worklist.push_back(b);
+            in_worklist[b] = true;
+        }
+    }
+
+    std::vector<uint16_t> splitter;
+    std::vector<uint32_t> touched;
+    while (!worklist.empty()) {
+        uint32_t current = worklist.back();
+        worklist.pop_back();
+        in_worklist[current] = false;
+        splitter.assign(elements.begin() + blocks[current].start,
+                        elements.begin() + blocks[current].end);
+        for (size_t a = 0; a < symbols; a++) {
+            for (uint16_t target : splitter) {
+                size_t id = a * state_count + target;
+                for (uint32_t i = pred_start[id]; i < pred_start[id + 1]; i++) {
+                    uint16_t q = preds[i];
+                    block &b = blocks[block_of[q]];
+                    uint32_t pos = location[q];
+                    if (pos < b.start + b.marked) {
+                        continue;
+                    }
+                    if (b.marked == 0) {
+                        touched.push_back(block_of[q]);
+                    }
+                    uint32_t swap_pos = b.start + b.marked;
+                    uint16_t other = elements[swap_pos];
+                    elements[swap_pos] = q;
+                    location[q] = swap_pos;
+                    elements[pos] = other;
+                    location[other] = pos;
+                    b.marked++;
+                }
+            }
+            for (uint32_t split : touched) {
+                block &b = blocks[split];
+                uint32_t marked = b.marked;
+                b.marked = 0;
+                if (marked == b.end - b.start) {
+                    continue;
+                }
+                uint32_t fresh = blocks.size();
+                uint32_t rest = b.end - b.start - marked;
+                blocks.push_back({b.start, b.start + marked, 0});
+                blocks[split].start += marked;
+                for (uint32_t i = blocks[fresh].start; i < blocks[fresh].end;
+                     i++) {
+                    block_of[elements[i]] = fresh;
+                }
+                in_worklist.push_back(false);
+                if (in_worklist[split]) {
+                    worklist.push_back(fresh);
+                    in_worklist[fresh] = true;
+                } else {
+                    uint32_t smaller = marked <= rest ? fresh : split;
+                    worklist.push_back(smaller);
+                    in_worklist[smaller] = true;
+                }
+            }
+            touched.clear();
+        }
+    }
+
+    // number the merged states in order of their first original member so
+    // the output stays stable between runs
+    std::vector<uint16_t> renumber(blocks.size(), 0xFFFF);
+    uint16_t new_count = 0;
+    for (uint16_t q = 0; q < state_count; q++) {
+        if (renumber[block_of[q]] == 0xFFFF) {
+            renumber[block_of[q]] = new_count++;
+        }
+    }
+    std::unordered_set<uint16_t> new_finals;
+    std::unordered_map<uint16_t, uint16_t> new_mapping;
+    for (uint16_t q : this->finals) {
+        new_finals.insert(renumber[block_of[q]]);
+    }
+    for (auto &pair : final_mapping) {
+        new_mapping[renumber[block_of[pair.first]]] = pair.second;
+    }
+    automaton resulting(new_count, new_finals, this->alphabet,
+                        renumber[block_of[this->initial]]);
+    for (size_t b = 0; b < blocks.size(); b++) {
+        uint16_t q = elements[blocks[b].start];
+        for (size_t a = 0; a < symbols; a++) {
+            uint16_t target = delta[q * symbols + a];
+            if (target < state_count) {
+                resulting.connect(renumber[b], renumber[block_of[target]],
+                                  a + 1);
+            }
+        }
+    }
+    final_mapping = std::move(new_mapping);
+    uint16_t new_trap = trap < state_count ? renumber[block_of[trap]] : new_count;
+    return std::make_pair(resulting, new_trap);
+}
@@ -4,31 +4,48 @@
 #include <vector>
 #include <algorithm>
 #include <set>
+#include <map>
 
-std::set<uint16_t> intersect_set(std::unordered_set<uint16_t> &set_a,
+typedef std::vector<uint16_t> state_set;
+
+struct state_set_hash {
+    size_t operator()(const state_set &set) const;
+};
+
+struct edge {
+    uint32_t input;
+    uint16_t end;
+};
+
+bool operator<(const edge &a, const edge &b);
+
+std::set<uint16_t> intersect_set(const state_set &set_a,
                                  std::unordered_set<uint16_t> &set_b);
 
 class automaton {
-    std::unordered_set<uint16_t> epsilon_closure(uint16_t state);
-    std::unordered_set<uint16_t> input_closure(
-        std::unordered_set<uint16_t> &state_e_closure, uint32_t input);
-    void _epsilon_closure_rec(std::unordered_set<uint16_t> &closure,
-                              uint16_t state);
-    void find_state_sets(std::vector<std::unordered_set<uint16_t>> &state_sets,
-                         std::unordered_map<uint64_t, uint16_t> &new_transition,
-                         std::unordered_set<uint16_t> &origin);
+    // epsilon closure of every state, filled once by compute_closures
+    std::vector<state_set> closures;
+    void compute_closures();
+    state_set input_closure(const state_set &state_e_closure, uint32_t input);
 
    public:
     uint16_t states, initial;
     uint32_t alphabet;
     std::unordered_set<uint16_t> finals;
-    std::unordered_map<uint64_t, uint16_t> transition;
+    // outgoing edges of every state, epsilon moves kept apart from the
+    // labelled ones; both lists are sorted so lookups can bisect them
+    std::vector<std::vector<uint16_t>> epsilon;
+    std::vector<std::vector<edge>> edges;
     automaton(uint16_t states, std::unordered_set<uint16_t> finals,
               uint32_t alphabet, uint16_t initial);
     void connect(uint16_t start, uint16_t end, uint32_t input);
     uint16_t get(uint16_t start, uint16_t end, uint32_t input);
+    uint16_t step(uint16_t start, uint32_t input) const;
     std::pair<automaton, uint16_t> powerset(
         std::unordered_map<uint16_t, uint16_t> &final_mapping,
         const std::unordered_map<uint16_t, std::string> &names);
+    std::vector<uint32_t> compress_alphabet();
+    std::pair<automaton, uint16_t> minimize(
+        std::unordered_map<uint16_t, uint16_t> &final_mapping, uint16_t trap);
     friend std::ostream &operator<<(std::ostream &stream, const automaton &el);
 };
\ No newline at end of file
@@ -5,42 +5,31 @@
 
 #include "lexer.hh"
 
-int main(int argc, char const *argv[]) {
-    std::string out_dir(argv[1]);
-    std::string rules_dir(argv[2]);
-    std::cout << "generating lexer in '" << out_dir << "' from rules at '"
-              << rules_dir << "'" << std::endl;
-
-    std::ifstream in_rules(rules_dir);
-    auto rules = read_rules(in_rules);
-    for (const rule &r : rules) {
-        std::cout << r.name << ": ";
-        r.match->print(std::cout) << std::endl;
-    }
-    dfa_meta dfa = create_full_dfa(std::move(rules));
-    // std::cout << dfa.machine << std::endl;
-    // std::cout << "trap: " << dfa.trap << std::endl;
-
-    generate_header(out_dir + "/tokens.h", dfa.names);
-    generate_cpp(out_dir + "/lexer.cc", dfa.machine, dfa.trap, dfa.names,
-                 dfa.final_mapping, dfa.alphabet);
-    return 0;
+static std::vector<std::vector<char_range>> merge_classes(
+    const std::vector<char_range> &alphabet,
+    const std::vector<uint32_t> &nfa_classes,
+    const std::vector<uint32_t> &dfa_classes) {
+    std::vector<std::vector<char_range>> classes(
+        *std::max_element(dfa_classes.begin(), dfa_classes.end()));
+    for (size_t i = 0; i < alphabet.size(); i++) {
+        auto &ranges = classes[dfa_classes[nfa_classes[i + 1]] - 1];
+        chr_t start = alphabet[i] >> 32;
+        if (!ranges.empty() && (chr_t)ranges.back() == start) {
+            ranges.back() = CHAR_RANGE(ranges.back() >> 32, (chr_t)alphabet[i]);
+        } else {
+            ranges.push_back(alphabet[i]);
+        }
+    }
+    return classes;
 }
 
-dfa_meta create_full_dfa(std::vector<rule> rules) {
-    std::unordered_map<size_t, std::string> names;
-    for (rule &r : rules) {
-        names[r.match->id()] = r.name;
-    }
-    std::vector<std::unique_ptr<ast>> match_seq;
-    for (rule &r : rules) {
-        match_seq.emplace_back(std::move(r.match));
-    }
-    auto match = std::make_unique<ast_alt>(std::move(match_seq));
+std::vector<char_range> rule_alphabet(const std::vector<rule *> &rules) {
     std::vector<char_range> alphabet;
     std::vector<chr_t> pre_alphabet;
     pre_alphabet.push_back(0);
-    match->construct_alphabet(pre_alphabet);
+    for (rule *r : rules) {
+        r->match->construct_alphabet(pre_alphabet);
+    }
     pre_alphabet.push_back(0x10FFFF + 2);
     std::sort(pre_alphabet.begin(), pre_alphabet.end());
     chr_t current = -1;
@@ -54,12 +43,25 @@ dfa_meta create_full_dfa(std::vector<rule> rules) {
             }
         }
     }
+    return alphabet;
+}
 
-    std::unordered_map<uint16_t, std::string> finals;
+automaton rule_nfa(const std::vector<rule *> &rules,
+                   std::vector<char_range> &alphabet,
+                   std::unordered_map<uint16_t, std::string> &finals) {
+    // the rules are the alternatives of one nfa starting in state 0, their
+    // final states are numbered in rule order
+    std::unordered_map<size_t, std::string> names;
+    for (rule *r : rules) {
+        names[r->match->id()] = r->name;
+    }
     automaton machine(0, std::unordered_set<uint16_t>{}, 0, 0);
-    uint16_t state_count = 0;
-    autopart part =
-        match->connect_machine(machine, alphabet, names, finals, &state_count);
+    uint16_t state_count = 1;
+    for (rule *r : rules) {
+        autopart part = r->match->connect_machine(machine, alphabet, names,
+                                                  finals, &state_count);
+        machine.connect(0, part.start, 0);
+    }
     machine.states = state_count;
     machine.alphabet = alphabet.size();
     std::unordered_set<uint16_t> actual_finals;
@@ -67,11 +69,366 @@ dfa_meta create_full_dfa(std::vector<rule> rules) {
         actual_finals.insert(fin.first);
     }
     machine.finals = actual_finals;
+    return machine;
+}
+
+static dfa_meta build_dfa(const std::vector<rule *> &rules) {
+    std::vector<char_range> alphabet = rule_alphabet(rules);
+    std::unordered_map<uint16_t, std::string> finals;
+    automaton machine = rule_nfa(rules, alphabet, finals);
     std::unordered_map<uint16_t, uint16_t> final_mapping;
     // std::cout << "nfa: " << machine << std::endl;
+    auto nfa_classes = machine.compress_alphabet();
     auto [dfa, dead] = machine.powerset(final_mapping, finals);
     // std::cout << "dfa: " << dfa << std::endl;
-    return {dfa, dead, finals, final_mapping, alphabet};
+    auto [min_dfa, min_dead] = dfa.minimize(final_mapping, dead);
+    std::cout << "minimized dfa from " << dfa.states << " to "
+              << min_dfa.states << " states" << std::endl;
+    auto dfa_classes = min_dfa.compress_alphabet();
+    std::cout << "compressed alphabet from " << alphabet.size() << " to "
+              << min_dfa.alphabet << " classes" << std::endl;
+    return {min_dfa, min_dead, finals, final_mapping,
+            merge_classes(alphabet, nfa_classes, dfa_classes), {}};
+}
+
+static uint32_t input_class(const dfa_meta &dfa, chr_t ch) {
+    for (size_t a = 0; a < dfa.alphabet.size(); a++) {
+        for (char_range range : dfa.alphabet[a]) {
+            if (ch >= (chr_t)(range >> 32) && ch < (chr_t)range) {
+                return a + 1;
+            }
+        }
+    }
+    return 0;
+}
+
+dfa_meta create_full_dfa(std::vector<rule> rules) {
+    // a literal rule that a rule of lower priority also matches doesn't need
+    // states of its own: the automaton is built without it and the lexer
+    // turns the other rule's token into the keyword when the text is equal.
+    // a literal repeated by a later rule can never match and is dropped
+    enum { in_automaton, extracted, shadowed };
+    std::vector<int> kinds(rules.size(), in_automaton);
+    std::vector<std::vector<chr_t>> texts(rules.size());
+    std::unordered_map<std::string, size_t> priority;
+    for (size_t i = 0; i < rules.size(); i++) {
+        priority[rules[i].name] = i;
+        if (rules[i].match->literal(texts[i]) && !texts[i].empty()) {
+            kinds[i] = extracted;
+        } else {
+            texts[i].clear();
+        }
+    }
+    for (size_t i = 0; i < rules.size(); i++) {
+        for (size_t j = i + 1; j < rules.size() && kinds[i] == extracted;
+             j++) {
+            if (kinds[j] == extracted && texts[j] == texts[i]) {
+                kinds[i] = shadowed;
+            }
+        }
+    }
+    auto automaton_rules = [&]() {
+        std::vector<rule *> selected;
+        for (size_t i = 0; i < rules.size(); i++) {
+            if (kinds[i] == in_automaton) {
+                selected.push_back(&rules[i]);
+            }
+        }
+        return selected;
+    };
+    std::vector<uint16_t> covering(rules.size());
+    auto covered = [&](dfa_meta &dfa) {
+        // walks every extracted literal through the automaton, the ones it
+        // doesn't accept with a rule of lower priority are put back
+        bool all = true;
+        for (size_t i = 0; i < rules.size(); i++) {
+            if (kinds[i] != extracted) {
+                continue;
+            }
+            uint16_t state = dfa.machine.initial;
+            for (chr_t ch : texts[i]) {
+                state = dfa.machine.step(state, input_class(dfa, ch));
+            }
+            auto mapping = dfa.final_mapping.find(state);
+            if (mapping != dfa.final_mapping.end() &&
+                priority[dfa.names[mapping->second]] < i) {
+                covering[i] = mapping->second;
+            } else {
+                kinds[i] = in_automaton;
+                all = false;
+            }
+        }
+        return all;
+    };
+    dfa_meta dfa = build_dfa(automaton_rules());
+    while (!covered(dfa)) {
+        dfa = build_dfa(automaton_rules());
+    }
+    // the rules left out get names keyed from the top of the id range,
+    // which nfa states never reach
+    uint16_t key = UINT16_MAX;
+    for (size_t i = 0; i < rules.size(); i++) {
+        if (kinds[i] == in_automaton) {
+            continue;
+        }
+        dfa.names[key] = rules[i].name;
+        if (kinds[i] == extracted) {
+            dfa.keywords.push_back({texts[i], covering[i], key});
+        }
+        key--;
+    }
+    if (!dfa.keywords.empty()) {
+        std::cout << "extracted " << dfa.keywords.size()
+                  << " keywords from the dfa" << std::endl;
+    }
+    return dfa;
+}
+
+typedef std::vector<std::pair<uint8_t, uint8_t>> byte_sequence;
+
+static std::vector<byte_sequence> utf8_sequences(chr_t start, chr_t end) {
+    // splits the inclusive code point range into ranges whose UTF-8
+    // encodings are a product of one byte range per position
+    static const chr_t max_of_length[] = {0x7F, 0x7FF, 0xFFFF, 0x10FFFF};
+    std::vector<byte_sequence> sequences;
+    std::vector<std::pair<chr_t, chr_t>> pending{{start, end}};
+    while (!pending.empty()) {
+        auto [lo, hi] = pending.back();
+        pending.pop_back();
+        bool split = false;
+        for (chr_t max : max_of_length) {
+            if (lo <= max && hi > max) {
+                pending.push_back({max + 1, hi});
+                pending.push_back({lo, max});
+                split = true;
+                break;
+            }
+        }
+        size_t length = lo <= 0x7F ? 1 : lo <= 0x7FF ? 2 : lo <= 0xFFFF ? 3 : 4;
+        for (size_t i = 1; !split && i < length; i++) {
+            chr_t mask = (1 << (6 * i)) - 1;
+            if ((lo & ~mask) != (hi & ~mask)) {
+                if ((lo & mask) != 0) {
+                    pending.push_back({(lo | mask) + 1, hi});
+                    pending.push_back({lo, lo | mask});
+                    split = true;
+                } else if ((hi & mask) != mask) {
+                    pending.push_back({hi & ~mask, hi});
+                    pending.push_back({lo, (hi & ~mask) - 1});
+                    split = true;
+                }
+            }
+        }
+        if (split) {
+            continue;
+        }
+        byte_sequence sequence(length);
+        for (size_t i = length - 1; i > 0; i--) {
+            sequence[i] = {0x80 | (lo & 0x3f), 0x80 | (hi & 0x3f)};
+            lo >>= 6;
+            hi >>= 6;
+        }
+        static const uint8_t lead[] = {0x00, 0xc0, 0xe0, 0xf0};
+        sequence[0] = {lead[length - 1] | lo, lead[length - 1] | hi};
+        sequences.push_back(sequence);
+    }
+    return sequences;
+}
+
+dfa_meta create_utf8_dfa(dfa_meta &dfa) {
+    // rebuilds the code point dfa as a byte nfa: every transition becomes
+    // chains of byte ranges spelling out the UTF-8 encodings of its class.
+    // chains to the same target share their common suffixes. code points
+    // past 0x10FFFF and invalid UTF-8 end up in the trap
+    automaton &machine = dfa.machine;
+    automaton bytes(machine.states, std::unordered_set<uint16_t>{}, 256,
+                    machine.initial);
+    std::unordered_map<uint16_t, std::string> state_names;
+    for (auto &pair : dfa.final_mapping) {
+        bytes.finals.insert(pair.first);
+        state_names[pair.first] = dfa.names[pair.second];
+    }
+    std::map<std::pair<byte_sequence, uint16_t>, uint16_t> suffixes;
+    uint32_t state_count = machine.states;
+    auto suffix_state = [&](const byte_sequence &sequence, size_t from,
+                            uint16_t target, auto &self) -> uint16_t {
+        if (from == sequence.size()) {
+            return target;
+        }
+        byte_sequence suffix(sequence.begin() + from, sequence.end());
+        auto known = suffixes.find({suffix, target});
+        if (known != suffixes.end()) {
+            return known->second;
+        }
+        uint16_t next = self(sequence, from + 1, target, self);
+        if (state_count > UINT16_MAX) {
+            throw std::runtime_error("utf8 nfa exceeds 65536 states");
+        }
+        uint16_t state = state_count++;
+        for (uint32_t b = sequence[from].first; b <= sequence[from].second;
+             b++) {
+            bytes.connect(state, next, b + 1);
+        }
+        suffixes.emplace(std::make_pair(suffix, target), state);
+        return state;
+    };
+    for (uint16_t i = 0; i < machine.states; i++) {
+        if (i == dfa.trap) {
+            continue;
+        }
+        for (uint32_t input = 1; input <= machine.alphabet; input++) {
+            uint16_t target = machine.step(i, input);
+            if (target == dfa.trap) {
+                continue;
+            }
+            for (char_range range : dfa.alphabet[input - 1]) {
+                chr_t start = range >> 32;
+                chr_t end = std::min<chr_t>((chr_t)range - 1, 0x10FFFF);
+                if (start > end) {
+                    continue;
+                }
+                for (byte_sequence &sequence : utf8_sequences(start, end)) {
+                    uint16_t next =
+                        suffix_state(sequence, 1, target, suffix_state);
+                    for (uint32_t b = sequence[0].first;
+                         b <= sequence[0].second; b++) {
+                        bytes.connect(i, next, b + 1);
+                    }
+                }
+            }
+        }
+    }
+    bytes.states = state_count;
+    std::vector<char_range> alphabet;
+    for (chr_t b = 0; b < 256; b++) {
+        alphabet.push_back(CHAR_RANGE(b, b + 1));
+    }
+    auto nfa_classes = bytes.compress_alphabet();
+    std::unordered_map<uint16_t, uint16_t> state_mapping;
+    auto [byte_dfa, dead] = bytes.powerset(state_mapping, state_names);
+    std::unordered_map<uint16_t, uint16_t> final_mapping;
+    for (auto &pair : state_mapping) {
+        final_mapping[pair.first] = dfa.final_mapping[pair.second];
+    }
+    auto [min_dfa, min_dead] = byte_dfa.minimize(final_mapping, dead);
+    std::cout << "utf8 dfa has " << min_dfa.states << " states" << std::endl;
+    auto dfa_classes = min_dfa.compress_alphabet();
+    std::vector<keyword> keywords;
+    for (keyword &word : dfa.keywords) {
+        // keywords are compared against the bytes of the token
+        std::vector<chr_t> encoded;
+        for (chr_t ch : word.text) {
+            byte_sequence sequence = utf8_sequences(ch, ch)[0];
+            for (auto &range : sequence) {
+                encoded.push_back(range.first);
+            }
+        }
+        keywords.push_back({encoded, word.rule, word.token});
+    }
+    return {min_dfa, min_dead, dfa.names, final_mapping,
+            merge_classes(alphabet, nfa_classes, dfa_classes), keywords};
+}
+
+static uint64_t machine_fingerprint(const automaton &machine) {
+    // identifies the automaton a profile was recorded with, state numbers
+    // only mean the same with the same transitions
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&](uint64_t value) { h = (h ^ value) * 1099511628211ull; };
+    mix(machine.states);
+    mix(machine.alphabet);
+    mix(machine.initial);
+    for (uint16_t i = 0; i < machine.states; i++) {
+        for (uint32_t input = 1; input <= machine.alphabet; input++) {
+            mix(machine.step(i, input));
+        }
+    }
+    return h;
+}
+
+lexer_profile apply_profile(dfa_meta &dfa, const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("unable to open profile: " + path);
+    }
+    std::string magic;
+    int version = 0;
+    uint64_t fingerprint = 0;
+    size_t states = 0, classes = 0;
+    in >> magic >> version >> fingerprint >> states >> classes;
+    if (!in || magic != "lexer-profile" || version != 1) {
+        throw std::runtime_error("not a lexer profile: " + path);
+    }
+    automaton &machine = dfa.machine;
+    if (fingerprint != machine_fingerprint(machine) ||
+        states != machine.states || classes != machine.alphabet) {
+        throw std::runtime_error(
+            "profile was recorded for a different automaton: " + path);
+    }
+    std::vector<std::vector<uint64_t>> counts(
+        states, std::vector<uint64_t>(classes + 1));
+    std::vector<uint64_t> visits(states);
+    // one entry per line, a truncated or otherwise broken line rejects the
+    // whole profile rather than laying out from part of it
+    std::string line;
+    std::getline(in, line);
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream entry(line);
+        size_t state, input;
+        uint64_t count;
+        std::string rest;
+        if (!(entry >> state >> input >> count) || entry >> rest ||
+            state >= states || input > classes) {
+            throw std::runtime_error("invalid entry in profile: " + path);
+        }
+        counts[state][input] += count;
+        visits[state] += count;
+    }
+    if (!in.eof()) {
+        throw std::runtime_error("unable to read profile: " + path);
+    }
+
+    // the hottest state becomes 0, the trap is never visited and goes last
+    std::vector<uint16_t> order(states);
+    for (size_t i = 0; i < states; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint16_t a, uint16_t b) {
+        if ((a == dfa.trap) != (b == dfa.trap)) {
+            return b == dfa.trap;
+        }
+        return visits[a] > visits[b];
+    });
+    std::vector<uint16_t> number(states);
+    for (size_t i = 0; i < states; i++) {
+        number[order[i]] = i;
+    }
+    std::unordered_set<uint16_t> finals;
+    for (uint16_t final : machine.finals) {
+        finals.insert(number[final]);
+    }
+    automaton renumbered(machine.states, finals, machine.alphabet,
+                         number[machine.initial]);
+    for (uint16_t i = 0; i < machine.states; i++) {
+        for (const edge &e : machine.edges[i]) {
+            renumbered.connect(number[i], number[e.end], e.input);
+        }
+    }
+    std::unordered_map<uint16_t, uint16_t> final_mapping;
+    for (auto &pair : dfa.final_mapping) {
+        final_mapping[number[pair.first]] = pair.second;
+    }
+    lexer_profile profile;
+    profile.counts.resize(states);
+    for (size_t i = 0; i < states; i++) {
+        profile.counts[number[i]] = std::move(counts[i]);
+    }
+    dfa.machine = renumbered;
+    dfa.trap = number[dfa.trap];
+    dfa.final_mapping = final_mapping;
+    return profile;
 }
 
 inline std::ostream &write_line(std::ostream &stream, const char *content,
@@ -86,59 +443,807 @@ inline std::ostream &write_line(std::ostream &stream, const char *content,
     return stream;
 }
 
+static const char *index_type(size_t max) {
+    return max <= UINT8_MAX ? "uint8_t" : "uint16_t";
+}
+
+struct class_range {
+    chr_t start;
+    chr_t end;
+    uint32_t input;
+};
+
+static std::vector<class_range> sorted_ranges(
+    const std::vector<std::vector<char_range>> &alphabet) {
+    std::vector<class_range> ranges;
+    for (size_t a = 0; a < alphabet.size(); a++) {
+        for (char_range range : alphabet[a]) {
+            ranges.push_back({(chr_t)(range >> 32), (chr_t)range,
+                              (uint32_t)a + 1});
+        }
+    }
+    std::sort(ranges.begin(), ranges.end(),
+              [](const class_range &a, const class_range &b) {
+                  return a.start < b.start;
+              });
+    return ranges;
+}
+
+static void write_classifier(
+    std::ostream &out, const std::vector<std::vector<char_range>> &alphabet) {
+    // maps a code point to its 1-based input class with a flat table for
+    // ASCII and a two-stage trie of 256 entry blocks for the rest. class 0
+    // is the end of input and everything outside the alphabet
+    const chr_t block_size = 256;
+    auto ranges = sorted_ranges(alphabet);
+    chr_t limit = ranges.back().end;
+    chr_t blocks = (limit + block_size - 1) / block_size;
+    std::vector<uint16_t> classes(blocks * block_size, 0);
+    for (class_range &range : ranges) {
+        std::fill(classes.begin() + range.start, classes.begin() + range.end,
+                  range.input);
+    }
+    const char *class_type = index_type(alphabet.size());
+    if (limit <= block_size) {
+        // a byte level lexer only needs the flat table
+        out << "static const " << class_type << " lexer_byte_class[256]={";
+        for (chr_t ch = 0; ch < 256; ch++) {
+            out << classes[ch] << ",";
+        }
+        out << "};" << std::endl
+            << "static inline uint16_t lexer_class(utf32::chr_t n){return "
+               "n<256?lexer_byte_class[n]:0;}"
+            << std::endl;
+        return;
+    }
+    std::vector<uint16_t> stage1;
+    std::vector<uint16_t> stage2;
+    std::map<std::vector<uint16_t>, uint16_t> known_blocks;
+    for (chr_t b = 0; b < blocks; b++) {
+        std::vector<uint16_t> block(classes.begin() + b * block_size,
+                                    classes.begin() + (b + 1) * block_size);
+        auto known = known_blocks.find(block);
+        if (known == known_blocks.end()) {
+            known = known_blocks.emplace(block, known_blocks.size()).first;
+            stage2.insert(stage2.end(), block.begin(), block.end());
+        }
+        stage1.push_back(known->second);
+    }
+    out << "static const " << class_type << " lexer_ascii_class[128]={";
+    for (chr_t ch = 0; ch < 128; ch++) {
+        out << classes[ch] << ",";
+    }
+    out << "};" << std::endl
+        << "static const " << index_type(known_blocks.size() - 1)
+        << " lexer_class_stage1[" << stage1.size() << "]={";
+    for (uint16_t block : stage1) {
+        out << block << ",";
+    }
+    out << "};" << std::endl
+        << "static const " << class_type << " lexer_class_stage2["
+        << stage2.size() << "]={";
+    for (size_t i = 0; i < stage2.size(); i++) {
+        out << stage2[i] << ",";
+        if (i % block_size == block_size - 1) {
+            out << std::endl;
+        }
+    }
+    out << "};" << std::endl
+        << "static inline uint16_t lexer_class(utf32::chr_t n){if(n<128)"
+           "return lexer_ascii_class[n];if(n>="
+        << limit
+        << ")return 0;return lexer_class_stage2[lexer_class_stage1[n>>8]<<8|"
+           "(n&255)];}"
+        << std::endl;
+}
+
+static std::vector<std::string> write_loop_sets(
+    std::ostream &out, const automaton &machine, uint16_t trap,
+    const std::vector<std::vector<char_range>> &alphabet) {
+    // a state that stays in place on some ASCII characters skips whole runs
+    // of them with a vectorized class test whenever it takes its self loop,
+    // states with the same loop share one set
+    auto ranges = sorted_ranges(alphabet);
+    std::vector<std::string> loops(machine.states);
+    std::map<std::vector<uint8_t>, std::string> known_sets;
+    for (uint16_t i = 0; i < machine.states; i++) {
+        if (i == trap) {
+            continue;
+        }
+        std::vector<uint8_t> bits(16, 0);
+        bool looping = false;
+        for (class_range &range : ranges) {
+            if (range.start >= 128 || machine.step(i, range.input) != i) {
+                continue;
+            }
+            for (chr_t c = range.start; c < std::min<chr_t>(range.end, 128);
+                 c++) {
+                bits[c & 15] |= 1 << (c >> 4);
+                looping = true;
+            }
+        }
+        if (!looping) {
+            continue;
+        }
+        auto known = known_sets.find(bits);
+        if (known == known_sets.end()) {
+            std::string name =
+                "lexer_loop_" + std::to_string(known_sets.size());
+            out << "static const ascii_set " << name << "={{";
+            for (uint8_t b : bits) {
+                out << (int)b << ",";
+            }
+            out << "}};" << std::endl;
+            known = known_sets.emplace(bits, name).first;
+        }
+        loops[i] = known->second;
+    }
+    return loops;
+}
+
+// every backend generates the dfa as lexer::scan, which is inlined into
+// both next and the loop of next_batch so a batch never leaves the dfa code
+#define SCAN_SIGNATURE \
+    "inline __attribute__((always_inline)) token lexer::scan()"
+
+static void write_profile_counters(std::ostream &out,
+                                   const automaton &machine) {
+    // counts every dispatch of lexer::scan by state and input class, and
+    // every character a loop set skipped under the class that entered the
+    // loop. each thread counts into its own lexer_profile, which is added to
+    // the totals when the thread ends. the totals are written to
+    // $LEXER_PROFILE or lexer.profile at exit
+    out << "#include <cstdio>" << std::endl
+        << "#include <cstdlib>" << std::endl
+        << "#include <mutex>" << std::endl
+        << "static uint64_t lexer_profile_total[" << machine.states << "]["
+        << machine.alphabet + 1 << "];" << std::endl
+        << "static std::mutex lexer_profile_mutex;" << std::endl
+        << "static struct lexer_profile_dump{~lexer_profile_dump(){std::"
+           "lock_guard<std::mutex> lock(lexer_profile_mutex);const char *path="
+           "std::getenv(\"LEXER_PROFILE\");std::FILE *f=std::fopen(path?path:"
+           "\"lexer.profile\",\"w\");if(!f)return;std::fprintf(f,\""
+           "lexer-profile 1 "
+        << machine_fingerprint(machine) << " " << machine.states << " "
+        << machine.alphabet
+        << "\\n\");for(unsigned s=0;s<" << machine.states
+        << ";s++)for(unsigned c=0;c<=" << machine.alphabet
+        << ";c++)if(lexer_profile_total[s][c])std::fprintf(f,\"%u %u %llu"
+           "\\n\",s,c,(unsigned long long)lexer_profile_total[s][c]);std::"
+           "fclose(f);}}lexer_profile_dump;"
+        << std::endl
+        << "static thread_local struct lexer_profile_counts{uint64_t counts["
+        << machine.states << "][" << machine.alphabet + 1
+        << "]={};~lexer_profile_counts(){std::lock_guard<std::mutex> lock("
+           "lexer_profile_mutex);for(unsigned s=0;s<"
+        << machine.states << ";s++)for(unsigned c=0;c<="
+        << machine.alphabet
+        << ";c++)lexer_profile_total[s][c]+=counts[s][c];}}lexer_profile;"
+        << std::endl;
+}
+
+static std::vector<bool> cold_states(const lexer_profile &profile,
+                                     uint16_t states) {
+    // states taking at most one in 10000 dispatches of the profile are laid
+    // out apart from the hot code
+    std::vector<bool> cold(states, false);
+    uint64_t total = 0;
+    std::vector<uint64_t> visits(states);
+    for (size_t i = 0; i < profile.counts.size(); i++) {
+        for (uint64_t count : profile.counts[i]) {
+            visits[i] += count;
+        }
+        total += visits[i];
+    }
+    // a profile of no input has nothing to tell hot from cold
+    if (total == 0) {
+        return cold;
+    }
+    for (size_t i = 0; i < profile.counts.size(); i++) {
+        cold[i] = visits[i] * 10000 <= total;
+    }
+    return cold;
+}
+
+static void write_cold_attribute(std::ostream &out) {
+    // marks the labels of cold code, clang ignores cold on labels
+    out << "#ifdef __clang__" << std::endl
+        << "#define LEXER_COLD __attribute__((unused))" << std::endl
+        << "#else" << std::endl
+        << "#define LEXER_COLD __attribute__((cold,unused))" << std::endl
+        << "#endif" << std::endl;
+}
+
+static void write_tables(
+    std::ostream &out, const automaton &machine, uint16_t trap,
+    std::unordered_map<uint16_t, std::string> &names,
+    const std::unordered_map<uint16_t, uint16_t> &final_mapping) {
+    // class 0 stands for the end of input and always leads to the trap
+    out << "static const uint16_t lexer_next[" << machine.states << "]["
+        << machine.alphabet + 1 << "]={" << std::endl;
+    for (uint16_t i = 0; i < machine.states; i++) {
+        out << "{" << trap << ",";
+        for (uint32_t input = 1; input <= machine.alphabet; input++) {
+            out << machine.step(i, input) << ",";
+        }
+        out << "}," << std::endl;
+    }
+    out << "};" << std::endl
+        << "static const token lexer_accept[" << machine.states << "]={";
+    for (uint16_t i = 0; i < machine.states; i++) {
+        auto mapping = final_mapping.find(i);
+        out << "token::"
+            << (mapping != final_mapping.end() ? names[mapping->second]
+                                               : "ERROR")
+            << ",";
+    }
+    out << "};" << std::endl;
+}
+
+static uint64_t keyword_hash(const std::vector<chr_t> &text) {
+    uint64_t h = 14695981039346656037ull;
+    for (chr_t unit : text) {
+        h = (h ^ unit) * 1099511628211ull;
+    }
+    return h;
+}
+
+static size_t keyword_slot(uint64_t h, uint32_t displace, int bits) {
+    return ((h ^ displace) * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+static void write_keyword_table(
+    std::ostream &out, const std::vector<keyword> &keywords,
+    std::unordered_map<uint16_t, std::string> &names, bool bytes) {
+    // hash and displace: the keywords are spread over a few buckets by
+    // their hash, then every bucket, largest first, searches for a value
+    // mixed into the hash that moves all its keywords to free slots. a
+    // lookup is one hash over the token and a single comparison
+    size_t buckets = (keywords.size() + 3) / 4;
+    std::vector<uint64_t> hashes;
+    for (const keyword &word : keywords) {
+        hashes.push_back(keyword_hash(word.text));
+    }
+    std::vector<std::vector<size_t>> members(buckets);
+    for (size_t i = 0; i < keywords.size(); i++) {
+        members[hashes[i] % buckets].push_back(i);
+    }
+    std::vector<size_t> order(buckets);
+    for (size_t i = 0; i < buckets; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return members[a].size() > members[b].size();
+    });
+    int bits = 1;
+    while ((size_t)1 << bits < keywords.size() + keywords.size() / 4) {
+        bits++;
+    }
+    std::vector<uint32_t> displace;
+    std::vector<uint16_t> slots;
+    for (bool placed = false; !placed; bits++) {
+        if (bits > 24) {
+            throw std::runtime_error("unable to build keyword hash table");
+        }
+        displace.assign(buckets, 0);
+        slots.assign((size_t)1 << bits, 0);
+        placed = true;
+        for (size_t bucket : order) {
+            bool found = false;
+            for (uint32_t d = 0; !found && d < (1 << 16); d++) {
+                std::vector<size_t> taken;
+                for (size_t i : members[bucket]) {
+                    size_t slot = keyword_slot(hashes[i], d, bits);
+                    if (slots[slot] != 0 ||
+                        std::find(taken.begin(), taken.end(), slot) !=
+                            taken.end()) {
+                        break;
+                    }
+                    taken.push_back(slot);
+                }
+                if (taken.size() == members[bucket].size()) {
+                    for (size_t k = 0; k < taken.size(); k++) {
+                        slots[taken[k]] = members[bucket][k] + 1;
+                    }
+                    displace[bucket] = d;
+                    found = true;
+                }
+            }
+            if (!found) {
+                placed = false;
+                break;
+            }
+        }
+        if (placed) {
+            break;
+        }
+    }
+    const char *unit = bytes ? "uint8_t" : "uint32_t";
+    out << "static const " << unit << " lexer_keyword_text[]={";
+    for (const keyword &word : keywords) {
+        for (chr_t ch : word.text) {
+            out << ch << ",";
+        }
+    }
+    out << "};" << std::endl
+        << "static const struct{uint32_t offset;uint32_t length;token rule;"
+           "token kind;}lexer_keywords["
+        << keywords.size() << "]={";
+    size_t offset = 0;
+    std::set<uint16_t> rules;
+    for (const keyword &word : keywords) {
+        out << "{" << offset << "," << word.text.size() << ",token::"
+            << names[word.rule] << ",token::" << names[word.token] << "},";
+        offset += word.text.size();
+        rules.insert(word.rule);
+    }
+    out << "};" << std::endl
+        << "static const uint32_t lexer_keyword_displace[" << buckets
+        << "]={";
+    for (uint32_t d : displace) {
+        out << d << ",";
+    }
+    out << "};" << std::endl
+        << "static const uint16_t lexer_keyword_slot[" << slots.size()
+        << "]={";
+    for (uint16_t slot : slots) {
+        out << slot << ",";
+    }
+    out << "};" << std::endl
+        << "static inline token lexer_keyword(token t,input::stringref text){"
+           "if(";
+    for (auto it = rules.begin(); it != rules.end(); it++) {
+        out << (it == rules.begin() ? "" : "&&") << "t!=token::" << names[*it];
+    }
+    out << ")return t;const " << unit << " *d=(const " << unit
+        << " *)text.data();size_t n=text.len();uint64_t h="
+           "14695981039346656037ull;for(size_t i=0;i<n;i++)h=(h^d[i])*"
+           "1099511628211ull;uint16_t k=lexer_keyword_slot[((h^"
+           "lexer_keyword_displace[h%"
+        << buckets << "])*0x9E3779B97F4A7C15ull)>>" << 64 - bits
+        << "];if(k==0)return t;const auto &w=lexer_keywords[k-1];if(w.rule!="
+           "t||w.length!=n)return t;for(size_t i=0;i<n;i++)if("
+           "lexer_keyword_text[w.offset+i]!=d[i])return t;return w.kind;}"
+        << std::endl;
+}
+
+static void write_entry_points(
+    std::ostream &out, const automaton &machine, uint16_t trap,
+    const std::vector<std::vector<char_range>> &alphabet,
+    std::unordered_map<uint16_t, std::string> &names,
+    const std::vector<keyword> &keywords) {
+    // next and next_batch run the backend's scan, dfa::scan and dfa::resume
+    // run the tables over a buffer for callers that lex without a stream.
+    // resume keeps everything it needs in a lexer_state, so it can stop
+    // between any two units
+    bool bytes = sorted_ranges(alphabet).back().end <= 256;
+    std::string reclassify;
+    std::string reclassify_buffer;
+    if (!keywords.empty()) {
+        write_keyword_table(out, keywords, names, bytes);
+        reclassify_buffer =
+            "if(a!=token::ERROR)a=lexer_keyword(a,input::stringref(const_cast"
+            "<input_unit *>(data+start),p-start));";
+        reclassify =
+            "t=lexer_keyword(t,this->stream.ref(this->m_tk_start,this->m_tk_"
+            "length));";
+    }
+    out << "token lexer::next(){token t=this->scan();" << reclassify
+        << "return t;}" << std::endl
+        << "size_t lexer::next_batch(token_buffer &buffer,size_t max){"
+           "buffer.reserve(max);token *kinds=buffer.kinds.data();size_t "
+           "*starts=buffer.starts.data();size_t *lengths=buffer.lengths.data()"
+           ";size_t n=0;while(n<max){token t=this->scan();"
+        << reclassify
+        << "kinds[n]=t;starts[n]=this->m_tk_start;lengths[n]=t==token::"
+           "ERROR?0:this->m_tk_length;n++;if(t==token::ERROR)break;}buffer."
+           "size=n;return n;}"
+        << std::endl
+        << "size_t dfa::scan(const input_unit *data,size_t length,size_t "
+           "start,token *kind){uint16_t s="
+        << machine.initial
+        << ";size_t p=start;while(1){uint16_t t=lexer_next[s][p<length?"
+           "lexer_class("
+        << (bytes ? "(uint8_t)data[p]" : "data[p]") << "):0];if(t==" << trap
+        << "){token a=lexer_accept[s];" << reclassify_buffer
+        << "*kind=a;return p-start;}s=t;p++;}}" << std::endl;
+    std::string classify = bytes ? "(uint8_t)data[i]" : "data[i]";
+    out << "lexer_state dfa::start(size_t offset){return lexer_state{"
+        << machine.initial << ",offset,offset};}" << std::endl
+        << "bool dfa::resume(lexer_state &state,const input_unit *data,size_t "
+           "length,bool last,token *kind){uint16_t s=state.dfa;size_t i=0;"
+           "while(1){uint16_t t;if(i<length)t=lexer_next[s][lexer_class("
+        << classify
+        << ")];else if(last)t=lexer_next[s][0];else{state.dfa=s;state."
+           "position+=i;return false;}if(t=="
+        << trap
+        << "){*kind=lexer_accept[s];state.position+=i;state.dfa="
+        << machine.initial
+        << ";state.start=state.position;return true;}s=t;i++;}}" << std::endl
+        << "token dfa::keyword(token kind,const input_unit *text,size_t "
+           "length){";
+    if (!keywords.empty()) {
+        out << "if(kind!=token::ERROR)kind=lexer_keyword(kind,input::"
+               "stringref(const_cast<input_unit *>(text),length));";
+    }
+    out << "return kind;}" << std::endl;
+}
+
+struct class_group {
+    uint32_t first;
+    uint32_t last;
+    uint16_t target;
+    uint64_t count;
+};
+
+static void write_state(std::ostream &out, const automaton &machine,
+                        uint16_t i, uint16_t trap, const std::string &loop,
+                        const std::string &fail, bool instrument,
+                        const std::vector<uint64_t> *counts) {
+    // the classes of a state grouped into runs with the same target. with a
+    // profile the hottest runs are tested first by comparisons when there
+    // are only a few, or a few of them together with leaving the state cover
+    // nearly all its dispatches. the rest is left to a switch, ordered by
+    // hotness
+    std::vector<class_group> groups;
+    uint64_t visits = 0, leaving = 0;
+    for (uint32_t a = 1; a <= machine.alphabet; a++) {
+        uint16_t next_state = machine.step(i, a);
+        uint32_t last = a;
+        while (last < machine.alphabet &&
+               machine.step(i, last + 1) == next_state) {
+            last++;
+        }
+        uint64_t count = 0;
+        for (uint32_t b = a; counts && b <= last; b++) {
+            count += (*counts)[b];
+        }
+        if (next_state != trap) {
+            groups.push_back({a, last, next_state, count});
+        } else {
+            leaving += count;
+        }
+        a = last;
+    }
+    if (counts) {
+        leaving += (*counts)[0];
+        visits = leaving;
+        for (class_group &group : groups) {
+            visits += group.count;
+        }
+    }
+    size_t chain = 0;
+    if (visits != 0) {
+        std::stable_sort(groups.begin(), groups.end(),
+                         [](const class_group &a, const class_group &b) {
+                             return a.count > b.count;
+                         });
+        uint64_t covered = leaving;
+        while (chain < groups.size() && chain < 3 &&
+               (covered * 10 < visits * 9 || groups.size() <= 3)) {
+            covered += groups[chain++].count;
+        }
+        if (covered * 10 < visits * 9) {
+            chain = 0;
+        }
+    }
+    auto action = [&](const class_group &group) {
+        if (group.target == i && !loop.empty()) {
+            out << (instrument ? "lexer_profile.counts[s][c]+=" : "")
+                << "this->stream.skip(" << loop << ");break;";
+        } else {
+            out << "s=" << group.target << ";break;";
+        }
+    };
+    for (size_t g = 0; g < chain; g++) {
+        if (groups[g].first == groups[g].last) {
+            out << "if(c==" << groups[g].first << "){";
+        } else {
+            out << "if(c>=" << groups[g].first << "&&c<=" << groups[g].last
+                << "){";
+        }
+        action(groups[g]);
+        out << "}";
+    }
+    if (chain == groups.size()) {
+        out << fail;
+        return;
+    }
+    out << "switch(c){";
+    for (size_t g = chain; g < groups.size(); g++) {
+        out << "case " << groups[g].first;
+        if (groups[g].last != groups[g].first) {
+            out << " ... " << groups[g].last;
+        }
+        out << ":";
+        action(groups[g]);
+    }
+    out << "default:" << fail << "}break;";
+}
+
 void generate_cpp(std::string dir, automaton machine, uint16_t trap,
                   std::unordered_map<uint16_t, std::string> names,
                   std::unordered_map<uint16_t, uint16_t> final_mapping,
-                  std::vector<char_range> alphabet) {
+                  std::vector<std::vector<char_range>> alphabet,
+                  std::vector<keyword> keywords,
+                  const lexer_profile &profile) {
+    // with a profile the states are numbered by hotness, the hot ones make
+    // up the main switch and the rarely visited ones are moved behind a
+    // cold label in its default
     std::ofstream out_code(dir);
-    out_code << "#include <lexer.hh>" << std::endl
-             << "token lexer::next(){uint16_t s=" << machine.initial
-             << ";this->m_tk_start=this->stream.pos();while(1){utf32::chr_t n="
-                "this->stream.get();switch(s){";
+    out_code << "#include <lexer.hh>" << std::endl;
+    if (profile.instrument) {
+        write_profile_counters(out_code, machine);
+    }
+    write_classifier(out_code, alphabet);
+    auto loops = write_loop_sets(out_code, machine, trap, alphabet);
+    std::vector<bool> is_cold = cold_states(profile, machine.states);
+    std::vector<uint16_t> hot, cold;
     for (uint16_t i = 0; i < machine.states; i++) {
         if (i != trap) {
-            out_code << "case " << i << ":switch(n){";
-            bool is_final = final_mapping.find(i) != final_mapping.end();
-            for (size_t a = 1; a <= machine.alphabet; a++) {
-                char_range range = alphabet[a - 1];
-                chr_t r_start = range >> 32;
-                chr_t r_end = range - 1;
-                uint16_t next_state;
-                uint64_t id = ((uint64_t)i) << 48 | a;
-                for (auto &pair : machine.transition) {
-                    if ((pair.first & 0xffff0000ffffffff) == id) {
-                        next_state = pair.second;
-                        break;
-                    }
-                }
-                if (!is_final || next_state != trap) {
-                    out_code << "case ";
-                    if (r_start != r_end) {
-                        out_code << r_start << " ... " << r_end << ":";
-                    } else {
-                        out_code << r_end << ":";
-                    }
-                    out_code << "s=" << next_state << ";break;";
+            (is_cold[i] ? cold : hot).push_back(i);
+        }
+    }
+    if (!cold.empty()) {
+        write_cold_attribute(out_code);
+    }
+    out_code << SCAN_SIGNATURE "{uint16_t s=" << machine.initial
+             << ";this->m_tk_start=this->stream.pin();while(1){uint16_t c="
+                "lexer_class(this->stream.get());"
+             << (profile.instrument ? "lexer_profile.counts[s][c]++;" : "")
+             << "switch(s){";
+    auto write_case = [&](uint16_t i) {
+        std::string fail = "return token::ERROR;";
+        auto mapping = final_mapping.find(i);
+        if (mapping != final_mapping.end()) {
+            fail = "this->stream.back();this->m_tk_length=this->stream.pos()-"
+                   "this->m_tk_start;return token::" +
+                   names[mapping->second] + ";";
+        }
+        out_code << "case " << i << ":";
+        write_state(out_code, machine, i, trap, loops[i], fail,
+                    profile.instrument,
+                    profile.counts.empty() ? nullptr : &profile.counts[i]);
+    };
+    for (uint16_t i : hot) {
+        write_case(i);
+    }
+    if (!cold.empty()) {
+        out_code << "default:lexer_cold:LEXER_COLD;switch(s){";
+        for (uint16_t i : cold) {
+            write_case(i);
+        }
+        out_code << "default:return token::ERROR;}break;}}return token::"
+                    "ERROR;}"
+                 << std::endl;
+    } else {
+        out_code << "default:return token::ERROR;}}return token::ERROR;}"
+                 << std::endl;
+    }
+    write_tables(out_code, machine, trap, names, final_mapping);
+    write_entry_points(out_code, machine, trap, alphabet, names, keywords);
+    out_code.close();
+}
+
+void generate_cpp_table(std::string dir, automaton machine, uint16_t trap,
+                        std::unordered_map<uint16_t, std::string> names,
+                        std::unordered_map<uint16_t, uint16_t> final_mapping,
+                        std::vector<std::vector<char_range>> alphabet,
+                        std::vector<keyword> keywords,
+                        const lexer_profile &profile) {
+    // a profile only matters through the state numbering, which puts the
+    // rows of hot states next to each other
+    std::ofstream out_code(dir);
+    out_code << "#include <lexer.hh>" << std::endl;
+    if (profile.instrument) {
+        write_profile_counters(out_code, machine);
+    }
+    write_classifier(out_code, alphabet);
+    auto loops = write_loop_sets(out_code, machine, trap, alphabet);
+    bool any_loop = false;
+    out_code << "static const ascii_set *const lexer_loop[" << machine.states
+             << "]={";
+    for (uint16_t i = 0; i < machine.states; i++) {
+        out_code << (loops[i].empty() ? "nullptr" : "&" + loops[i]) << ",";
+        any_loop |= !loops[i].empty();
+    }
+    out_code << "};" << std::endl;
+    write_tables(out_code, machine, trap, names, final_mapping);
+    out_code << SCAN_SIGNATURE "{uint16_t s=" << machine.initial
+             << ";this->m_tk_start=this->stream.pin();while(1){uint16_t c="
+                "lexer_class(this->stream.get());"
+             << (profile.instrument ? "lexer_profile.counts[s][c]++;" : "")
+             << "uint16_t t=lexer_next[s][c];if(t=="
+             << trap
+             << "){if(lexer_accept[s]==token::ERROR)return token::ERROR;"
+                "this->stream.back();this->m_tk_length=this->stream.pos()-"
+                "this->m_tk_start;return lexer_accept[s];}"
+             << (any_loop ? "if(t==s&&lexer_loop[s])" : "")
+             << (any_loop && profile.instrument
+                     ? "lexer_profile.counts[s][c]+="
+                     : "")
+             << (any_loop ? "this->stream.skip(*lexer_loop[s]);" : "")
+             << "s=t;}}" << std::endl;
+    write_entry_points(out_code, machine, trap, alphabet, names, keywords);
+    out_code.close();
+}
+
+struct target_range {
+    chr_t start;
+    chr_t end;
+    uint16_t target;
+};
+
+// jumps to a state, edges back into a state with a loop set go to its L
+// label, which skips the rest of the run first
+static void write_jump(std::ostream &out, uint16_t target, uint16_t loop) {
+    out << "goto " << (target == loop ? "L" : "S") << target << ";";
+}
+
+static void write_dispatch(std::ostream &out,
+                           const std::vector<target_range> &ranges, size_t lo,
+                           size_t hi, uint16_t trap, uint16_t loop,
+                           const std::string &fail) {
+    if (lo == hi) {
+        if (ranges[lo].target == trap) {
+            out << fail;
+        } else {
+            write_jump(out, ranges[lo].target, loop);
+        }
+        return;
+    }
+    size_t mid = (lo + hi + 1) / 2;
+    out << "if(n<" << ranges[mid].start << "){";
+    write_dispatch(out, ranges, lo, mid - 1, trap, loop, fail);
+    out << "}";
+    write_dispatch(out, ranges, mid, hi, trap, loop, fail);
+}
+
+static void write_jump_table(std::ostream &out, const char *subject,
+                             const std::vector<target_range> &ranges,
+                             size_t lo, size_t hi, uint16_t trap,
+                             uint16_t loop, const std::string &fail) {
+    out << "switch(" << subject << "){";
+    for (size_t i = lo; i <= hi; i++) {
+        if (ranges[i].target == trap) {
+            continue;
+        }
+        out << "case " << ranges[i].start;
+        if (ranges[i].start != ranges[i].end) {
+            out << " ... " << ranges[i].end;
+        }
+        out << ":";
+        write_jump(out, ranges[i].target, loop);
+    }
+    out << "}" << fail;
+}
+
+void generate_cpp_goto(std::string dir, automaton machine, uint16_t trap,
+                       std::unordered_map<uint16_t, std::string> names,
+                       std::unordered_map<uint16_t, uint16_t> final_mapping,
+                       std::vector<std::vector<char_range>> alphabet,
+                       std::vector<keyword> keywords,
+                       const lexer_profile &profile) {
+    // every state becomes a label that reads one character and branches on
+    // it through a balanced decision tree over its outgoing ranges, with the
+    // ASCII ranges split off and tested first. dense ASCII dispatch with
+    // many ranges is left to a switch so the compiler can build a jump table,
+    // states with many ranges outside ASCII switch over the input class.
+    // with a profile the labels follow the hotness of the states and the
+    // rarely visited ones are marked cold
+    std::ofstream out_code(dir);
+    out_code << "#include <lexer.hh>" << std::endl;
+    if (profile.instrument) {
+        write_profile_counters(out_code, machine);
+    }
+    write_classifier(out_code, alphabet);
+    std::vector<bool> is_cold = cold_states(profile, machine.states);
+    if (!profile.counts.empty()) {
+        write_cold_attribute(out_code);
+    }
+    auto loops = write_loop_sets(out_code, machine, trap, alphabet);
+    auto ranges = sorted_ranges(alphabet);
+    out_code << SCAN_SIGNATURE "{utf32::chr_t n;this->m_tk_start="
+                "this->stream.pin();goto S"
+             << machine.initial << ";" << std::endl;
+    for (uint16_t i = 0; i < machine.states; i++) {
+        if (i == trap) {
+            continue;
+        }
+        auto mapping = final_mapping.find(i);
+        std::string fail = mapping != final_mapping.end()
+                               ? "goto A" + std::to_string(i) + ";"
+                               : "return token::ERROR;";
+        std::vector<target_range> ascii, wide, wide_classes;
+        std::set<uint32_t> wide_inputs;
+        for (class_range &range : ranges) {
+            chr_t r_end = range.end - 1;
+            uint16_t target = machine.step(i, range.input);
+            if (range.start < 128) {
+                ascii.push_back(
+                    {range.start, std::min<chr_t>(r_end, 127), target});
+            }
+            if (r_end >= 128) {
+                wide.push_back(
+                    {std::max<chr_t>(range.start, 128), r_end, target});
+                wide_inputs.insert(range.input);
+            }
+        }
+        for (uint32_t input : wide_inputs) {
+            wide_classes.push_back({input, input, machine.step(i, input)});
+        }
+        wide.push_back({wide.back().end + 1, 0xFFFFFFFF, trap});
+        for (auto *part : {&ascii, &wide, &wide_classes}) {
+            std::vector<target_range> merged;
+            for (target_range &r : *part) {
+                if (!merged.empty() && merged.back().target == r.target) {
+                    merged.back().end = r.end;
+                } else {
+                    merged.push_back(r);
                 }
             }
-            if (is_final) {
-                out_code << "default:this->stream.back();this->m_tk_length="
-                            "this->stream.pos()-this->m_tk_start;return token::"
-                         << names[final_mapping[i]] << ";";
+            *part = std::move(merged);
+        }
+        const char *cold = is_cold[i] ? "LEXER_COLD;" : "";
+        uint16_t loop = trap;
+        if (!loops[i].empty()) {
+            loop = i;
+            out_code << "L" << i << ":" << cold
+                     << (profile.instrument
+                             ? "lexer_profile.counts[" + std::to_string(i) +
+                                   "][lexer_class(n)]+="
+                             : "")
+                     << "this->stream.skip(" << loops[i] << ");";
+        }
+        out_code << "S" << i << ":" << cold << "n=this->stream.get();";
+        if (profile.instrument) {
+            out_code << "lexer_profile.counts[" << i << "][lexer_class(n)]++;";
+        }
+        if (ascii.size() == 1 && wide.size() == 1 &&
+            ascii[0].target == wide[0].target) {
+            write_dispatch(out_code, ascii, 0, 0, trap, loop, fail);
+        } else {
+            out_code << "if(n<128){";
+            if (ascii.size() > 4) {
+                write_jump_table(out_code, "n", ascii, 0, ascii.size() - 1,
+                                 trap, loop, fail);
+            } else {
+                write_dispatch(out_code, ascii, 0, ascii.size() - 1, trap,
+                               loop, fail);
+            }
+            out_code << "}";
+            if (wide.size() > 8) {
+                write_jump_table(out_code, "lexer_class(n)", wide_classes, 0,
+                                 wide_classes.size() - 1, trap, loop, fail);
             } else {
-                out_code << "case 0xFFFFFFFF:return token::ERROR;default:s="
-                         << trap << ";break;";
+                write_dispatch(out_code, wide, 0, wide.size() - 1, trap, loop,
+                               fail);
             }
-            out_code << "}break;";
         }
+        out_code << std::endl;
+    }
+    for (auto &pair : final_mapping) {
+        if (pair.first == trap) {
+            continue;
+        }
+        out_code << "A" << pair.first
+                 << ":this->stream.back();this->m_tk_length=this->stream.pos()"
+                    "-this->m_tk_start;return token::"
+                 << names[pair.second] << ";" << std::endl;
     }
-    out_code << "default:return token::ERROR;}}return token::ERROR;}";
+    out_code << "}" << std::endl;
+    write_tables(out_code, machine, trap, names, final_mapping);
+    write_entry_points(out_code, machine, trap, alphabet, names, keywords);
     out_code.close();
 }
 
 void generate_header(std::string dir,
-                     std::unordered_map<uint16_t, std::string> names) {
+                     std::unordered_map<uint16_t, std::string> names,
+                     bool utf8) {
     std::ofstream out_header(dir);
+    if (utf8) {
+        out_header << "#define LEXER_UTF8" << std::endl;
+    }
     out_header << "enum token {" << std::endl << "    ERROR," << std::endl;
     for (auto &pair : names) {
         out_header << "    " << pair.second.c_str() << "," << std::endl;
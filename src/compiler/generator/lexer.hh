@@ -2,19 +2,72 @@
 
 char_range make_char_range(chr_t start, chr_t end);
 
+// a literal rule taken out of the automaton, the lexer reclassifies tokens
+// of the rule that matches the same text in the automaton instead
+struct keyword {
+    // the literal in the units the automaton reads
+    std::vector<chr_t> text;
+    // keys of the covering rule and of the keyword itself in names
+    uint16_t rule;
+    uint16_t token;
+};
+
 struct dfa_meta {
     automaton machine;
     uint16_t trap;
     std::unordered_map<uint16_t, std::string> names;
     std::unordered_map<uint16_t, uint16_t> final_mapping;
-    std::vector<char_range> alphabet;
+    // the code point ranges making up each input class
+    std::vector<std::vector<char_range>> alphabet;
+    std::vector<keyword> keywords;
 };
 
+// the phases of create_full_dfa before the powerset construction: the
+// elementary ranges the rules' sets are made of, and the nfa with every rule
+// as an alternative from state 0. finals maps final states to rule names
+std::vector<char_range> rule_alphabet(const std::vector<rule *> &rules);
+automaton rule_nfa(const std::vector<rule *> &rules,
+                   std::vector<char_range> &alphabet,
+                   std::unordered_map<uint16_t, std::string> &finals);
+
 dfa_meta create_full_dfa(std::vector<rule> rules);
 
-void generate_header(std::string dir, std::unordered_map<uint16_t, std::string> names);
+dfa_meta create_utf8_dfa(dfa_meta &dfa);
+
+// dispatch counts recorded by a lexer generated with instrument set, per
+// state and input class. characters skipped by a loop set count as
+// dispatches of the class that entered the loop. the backends lay out hot
+// states and transitions first when counts is filled
+struct lexer_profile {
+    bool instrument = false;
+    std::vector<std::vector<uint64_t>> counts;
+};
+
+// reads a profile written by an instrumented lexer of the same automaton and
+// renumbers the states of dfa by hotness, the counts are returned in the
+// new numbering
+lexer_profile apply_profile(dfa_meta &dfa, const std::string &path);
+
+void generate_header(std::string dir, std::unordered_map<uint16_t, std::string> names,
+                     bool utf8);
 
 void generate_cpp(std::string dir, automaton machine, uint16_t trap,
                   std::unordered_map<uint16_t, std::string> names,
                   std::unordered_map<uint16_t, uint16_t> final_mapping,
-                  std::vector<char_range> alphabet);
\ No newline at end of file
+                  std::vector<std::vector<char_range>> alphabet,
+                  std::vector<keyword> keywords,
+                  const lexer_profile &profile);
+
+void generate_cpp_table(std::string dir, automaton machine, uint16_t trap,
+                        std::unordered_map<uint16_t, std::string> names,
+                        std::unordered_map<uint16_t, uint16_t> final_mapping,
+                        std::vector<std::vector<char_range>> alphabet,
+                        std::vector<keyword> keywords,
+                        const lexer_profile &profile);
+
+void generate_cpp_goto(std::string dir, automaton machine, uint16_t trap,
+                       std::unordered_map<uint16_t, std::string> names,
+                       std::unordered_map<uint16_t, uint16_t> final_mapping,
+                       std::vector<std::vector<char_range>> alphabet,
+                       std::vector<keyword> keywords,
+                       const lexer_profile &profile);
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include <fstream>
+
+#include "lexer.hh"
+
+int main(int argc, char const *argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0]
+                  << " <out dir> <rules> [--backend=switch|table|goto]"
+                     " [--utf8] [--instrument | --profile=<file>]"
+                  << std::endl;
+        return 1;
+    }
+    std::string out_dir(argv[1]);
+    std::string rules_dir(argv[2]);
+    std::string backend = "switch";
+    bool utf8 = false;
+    bool instrument = false;
+    std::string profile_path;
+    for (int i = 3; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.starts_with("--backend=")) {
+            backend = arg.substr(10);
+        } else if (arg == "--utf8") {
+            utf8 = true;
+        } else if (arg == "--instrument") {
+            instrument = true;
+        } else if (arg.starts_with("--profile=")) {
+            profile_path = arg.substr(10);
+        } else {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (backend != "switch" && backend != "table" && backend != "goto") {
+        std::cerr << "unknown backend: " << backend << std::endl;
+        return 1;
+    }
+    if (instrument && !profile_path.empty()) {
+        // a profile names the states of the automaton it was recorded with,
+        // which the layout renumbers
+        std::cerr << "--instrument and --profile can't be combined"
+                  << std::endl;
+        return 1;
+    }
+    std::cout << "generating " << backend << (utf8 ? " utf8" : "")
+              << " lexer in '" << out_dir
+              << "' from rules at '" << rules_dir << "'" << std::endl;
+
+    std::ifstream in_rules(rules_dir);
+    auto rules = read_rules(in_rules);
+    for (const rule &r : rules) {
+        std::cout << r.name << ": ";
+        r.match->print(std::cout) << std::endl;
+    }
+    dfa_meta dfa = create_full_dfa(std::move(rules));
+    if (utf8) {
+        dfa = create_utf8_dfa(dfa);
+    }
+    lexer_profile profile;
+    profile.instrument = instrument;
+    if (!profile_path.empty()) {
+        profile = apply_profile(dfa, profile_path);
+        std::cout << "laid out states by the profile at '" << profile_path
+                  << "'" << std::endl;
+    }
+    // std::cout << dfa.machine << std::endl;
+    // std::cout << "trap: " << dfa.trap << std::endl;
+
+    generate_header(out_dir + "/tokens.h", dfa.names, utf8);
+    if (backend == "table") {
+        generate_cpp_table(out_dir + "/lexer.cc", dfa.machine, dfa.trap,
+                           dfa.names, dfa.final_mapping, dfa.alphabet,
+                           dfa.keywords, profile);
+    } else if (backend == "goto") {
+        generate_cpp_goto(out_dir + "/lexer.cc", dfa.machine, dfa.trap,
+                          dfa.names, dfa.final_mapping, dfa.alphabet,
+                          dfa.keywords, profile);
+    } else {
+        generate_cpp(out_dir + "/lexer.cc", dfa.machine, dfa.trap, dfa.names,
+                     dfa.final_mapping, dfa.alphabet, dfa.keywords,
+                     profile);
+    }
+    return 0;
+}
@@ -3,14 +3,62 @@
 lexer::lexer(std::istream &stream)
     : stream(stream), m_tk_start(0), m_tk_length(0) {}
 
-lexer::lexer(utf32::stream stream)
+lexer::lexer(input::stream stream)
     : stream(std::move(stream)), m_tk_start(0), m_tk_length(0) {}
 
+lexer::lexer(mapped_file file)
+    : stream(std::move(file)), m_tk_start(0), m_tk_length(0) {}
+
+void lexer::reset(mapped_file file) {
+    this->stream.reset(std::move(file));
+    this->m_tk_start = 0;
+    this->m_tk_length = 0;
+}
+
 size_t lexer::tk_start() { return this->m_tk_start; }
 
 size_t lexer::tk_len() { return this->m_tk_length; }
 
-utf32::stringref lexer::tk_str() {
-    return utf32::stringref(this->stream.data(), this->m_tk_start,
-                            this->m_tk_length);
+input::stringref lexer::tk_str() {
+    return this->stream.ref(this->m_tk_start, this->m_tk_length);
+}
+
+span lexer::tk_span() { return span{this->m_tk_start, this->m_tk_length}; }
+
+position lexer::tk_position() { return this->stream.locate(this->m_tk_start); }
+
+position lexer::locate(size_t offset) { return this->stream.locate(offset); }
+
+bool lexer::finished() {
+    // the end is an ERROR whose first read found no unit. get moves on even
+    // at the end, so stepping back and reading again restores the position
+    if (this->stream.pos() != this->m_tk_start + 1) {
+        return false;
+    }
+    this->stream.back();
+    bool end = this->stream.end();
+    this->stream.get();
+    return end;
+}
+
+void token_buffer::reserve(size_t capacity) {
+    if (this->kinds.size() < capacity) {
+        this->kinds.resize(capacity);
+        this->starts.resize(capacity);
+        this->lengths.resize(capacity);
+    }
+}
+
+size_t token_buffer::drop(token kind) {
+    // branch free compaction, every entry is copied and the write position
+    // only advances past the ones that are kept
+    size_t kept = 0;
+    for (size_t i = 0; i < this->size; i++) {
+        this->kinds[kept] = this->kinds[i];
+        this->starts[kept] = this->starts[i];
+        this->lengths[kept] = this->lengths[i];
+        kept += this->kinds[i] != kind;
+    }
+    this->size = kept;
+    return kept;
 }
\ No newline at end of file
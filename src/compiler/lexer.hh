@@ -1,19 +1,87 @@
 #pragma once
 
 #include "utf32.hh"
+#include "utf8.hh"
 
 #include <tokens.h>
+#include <type_traits>
+#include <vector>
+
+// a lexer generated with --utf8 runs on the raw bytes of its input, token
+// positions and lengths are then byte offsets and tk_str refers straight to
+// the source bytes
+#ifdef LEXER_UTF8
+namespace input = utf8;
+typedef char input_unit;
+#else
+namespace input = utf32;
+typedef utf32::chr_t input_unit;
+#endif
+
+// tokens stored as parallel arrays, filled by lexer::next_batch. only the
+// first size entries are valid, the arrays may be longer. an ERROR token
+// always has length 0
+struct token_buffer {
+    std::vector<token> kinds;
+    std::vector<size_t> starts;
+    std::vector<size_t> lengths;
+    size_t size = 0;
+    void reserve(size_t capacity);
+    size_t drop(token kind);
+};
 
 class lexer {
-    utf32::stream stream;
+    input::stream stream;
     size_t m_tk_start;
     size_t m_tk_length;
+    token scan();
 
    public:
     lexer(std::istream &stream);
-    lexer(utf32::stream stream);
+    lexer(input::stream stream);
+    lexer(mapped_file file);
+    // lexes file from the start, reusing the stream's buffers
+    void reset(mapped_file file);
     token next();
-    utf32::stringref tk_str();
+    size_t next_batch(token_buffer &buffer, size_t max);
+    input::stringref tk_str();
     size_t tk_start();
     size_t tk_len();
+    span tk_span();
+    position tk_position();
+    position locate(size_t offset);
+    // after next returned ERROR, true when that is the end of the input
+    // rather than an invalid token
+    bool finished();
 };
+
+// where lexing stands between two units of the input: the dfa state and the
+// offsets of the current token's start and of the next unit to read. the
+// generated dfa never backtracks, a token ends as soon as the next unit has
+// no transition, so no earlier accepting position has to be kept
+struct lexer_state {
+    uint16_t dfa;
+    size_t start;
+    size_t position;
+};
+static_assert(std::is_trivially_copyable<lexer_state>::value,
+              "lexer_state is saved and restored by copying");
+
+// the generated dfa as plain tables, run over a buffer of input units. scan
+// matches the token starting at start like lexer::next and returns its
+// length
+namespace dfa {
+    size_t scan(const input_unit *data, size_t length, size_t start,
+                token *kind);
+    // the state before a token starting at offset
+    lexer_state start(size_t offset);
+    // runs the dfa on from state over data, the length units from
+    // state.position on. returns true once a token ended, with its kind and
+    // the state moved to the start of the next one, the token spans from
+    // the previous state.start to the new one. returns false with all units
+    // consumed otherwise. last tells that the input ends after data. kinds
+    // are rule tokens, keyword tells keywords apart given the token's units
+    bool resume(lexer_state &state, const input_unit *data, size_t length,
+                bool last, token *kind);
+    token keyword(token kind, const input_unit *text, size_t length);
+}
\ No newline at end of file
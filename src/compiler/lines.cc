@@ -0,0 +1,74 @@
+#include "lines.hh"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+line_index::line_index() : m_starts{0}, m_scanned(0) {}
+
+void line_index::reset() {
+    this->m_starts.resize(1);
+    this->m_scanned = 0;
+}
+
+size_t line_index::scanned() { return this->m_scanned; }
+
+void line_index::scan(const char *bytes, size_t length) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(bytes + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        while (mask != 0) {
+            this->m_starts.push_back(this->m_scanned + i +
+                                     __builtin_ctz(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        if (bytes[i] == '\n') {
+            this->m_starts.push_back(this->m_scanned + i + 1);
+        }
+    }
+    this->m_scanned += length;
+}
+
+void line_index::scan(const uint32_t *chars, size_t length) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // compare four code points at a time and keep one mask bit per lane
+    const __m128i newline = _mm_set1_epi32('\n');
+    for (; i + 16 <= length; i += 16) {
+        const __m128i *block = (const __m128i *)(chars + i);
+        __m128i a = _mm_cmpeq_epi32(_mm_loadu_si128(block), newline);
+        __m128i b = _mm_cmpeq_epi32(_mm_loadu_si128(block + 1), newline);
+        __m128i c = _mm_cmpeq_epi32(_mm_loadu_si128(block + 2), newline);
+        __m128i d = _mm_cmpeq_epi32(_mm_loadu_si128(block + 3), newline);
+        unsigned mask = _mm_movemask_epi8(_mm_packs_epi16(
+            _mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+        while (mask != 0) {
+            this->m_starts.push_back(this->m_scanned + i +
+                                     __builtin_ctz(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        if (chars[i] == '\n') {
+            this->m_starts.push_back(this->m_scanned + i + 1);
+        }
+    }
+    this->m_scanned += length;
+}
+
+position line_index::locate(size_t offset) {
+    auto line = std::upper_bound(this->m_starts.begin(), this->m_starts.end(),
+                                 offset) -
+                1;
+    return position{(size_t)(line - this->m_starts.begin()) + 1,
+                    offset - *line + 1};
+}
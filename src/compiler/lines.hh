@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// line and column of an offset, both counted from 1
+struct position {
+    size_t line;
+    size_t column;
+};
+
+// offset and length of a token in the units of its stream
+struct span {
+    size_t offset;
+    size_t length;
+};
+
+// records where lines start in a text that is fed to it in order. newlines
+// are found a whole block at a time, so nothing is counted per character
+// while lexing and a position is only computed when it is asked for
+class line_index {
+    std::vector<size_t> m_starts;
+    size_t m_scanned;
+
+   public:
+    line_index();
+    // forgets every line, keeping the storage for the next text
+    void reset();
+    size_t scanned();
+    void scan(const char *bytes, size_t length);
+    void scan(const uint32_t *chars, size_t length);
+    position locate(size_t offset);
+};
@@ -1,22 +1,76 @@
+#include "driver.hh"
 #include "parser.hh"
 
-#include <fstream>
+#include <charconv>
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
+
+static int usage(const char *program) {
+    std::cerr << "usage: " << program
+              << " [--threads=n] [--dump] <file|dir|@list>..." << std::endl;
+    return 1;
+}
+
+// parses the whole of value as a thread count
+static bool parse_threads(const std::string &value, unsigned *threads) {
+    const char *last = value.data() + value.size();
+    auto [end, error] = std::from_chars(value.data(), last, *threads);
+    return !value.empty() && error == std::errc() && end == last;
+}
 
 int main(int argc, char const *argv[]) {
-    std::string path = "../test.sp";
-    std::ifstream in_file(path);
-    if (!in_file.is_open()) {
-        throw std::runtime_error("unable to open file: " + path);
+    unsigned threads = std::thread::hardware_concurrency();
+    bool dump = false;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.compare(0, 10, "--threads=") == 0) {
+            if (!parse_threads(arg.substr(10), &threads)) {
+                return usage(argv[0]);
+            }
+        } else if (arg == "--dump") {
+            dump = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            return usage(argv[0]);
+        } else {
+            args.push_back(arg);
+        }
     }
-    lexer my_lexer(in_file);
-    while (1) {
-        token t = my_lexer.next();
-        auto s = my_lexer.tk_str();
-        if (t == token::ERROR) {
-            break;
+    if (args.empty()) {
+        args.push_back("../test.sp");
+        dump = true;
+    }
+
+    std::vector<std::string> files;
+    try {
+        files = collect_files(args);
+    } catch (const std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<lex_result> results = lex_files(files, &threads, dump);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    size_t bytes = 0, tokens = 0, failed = 0;
+    for (lex_result &result : results) {
+        std::cout << result.path << "\t" << result.bytes << " bytes\t"
+                  << result.tokens << " tokens\t" << result.seconds * 1000
+                  << " ms";
+        if (!result.error.empty()) {
+            std::cout << "\t" << result.error;
+            failed++;
         }
-        std::cout << t << ": '" << s << "'" << std::endl;
+        std::cout << std::endl << result.dump;
+        bytes += result.bytes;
+        tokens += result.tokens;
     }
-    return 0;
+    std::cout << "total: " << results.size() << " files, " << bytes
+              << " bytes, " << tokens << " tokens, " << seconds * 1000
+              << " ms on " << threads << " threads" << std::endl;
+    return failed == 0 ? 0 : 1;
 }
@@ -0,0 +1,57 @@
+#include "mapping.hh"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+mapped_file::mapped_file() : m_data(nullptr), m_length(0) {}
+
+mapped_file::mapped_file(const std::string &path)
+    : m_data(nullptr), m_length(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("unable to open file: " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        throw std::runtime_error("unable to stat file: " + path);
+    }
+    this->m_length = info.st_size;
+    if (this->m_length > 0) {
+        void *mapping =
+            mmap(nullptr, this->m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("unable to map file: " + path);
+        }
+        madvise(mapping, this->m_length, MADV_SEQUENTIAL);
+        this->m_data = (const char *)mapping;
+    }
+    close(fd);
+}
+
+mapped_file::mapped_file(mapped_file &&other)
+    : m_data(other.m_data), m_length(other.m_length) {
+    other.m_data = nullptr;
+    other.m_length = 0;
+}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) {
+    std::swap(this->m_data, other.m_data);
+    std::swap(this->m_length, other.m_length);
+    return *this;
+}
+
+mapped_file::~mapped_file() {
+    if (this->m_data != nullptr) {
+        munmap((void *)this->m_data, this->m_length);
+    }
+}
+
+size_t mapped_file::len() { return this->m_length; }
+
+const char *mapped_file::data() { return this->m_data; }
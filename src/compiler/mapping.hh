@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+// read-only mapping of a whole file, advised for sequential access
+class mapped_file {
+    const char *m_data;
+    size_t m_length;
+
+   public:
+    mapped_file();
+    mapped_file(const std::string &path);
+    mapped_file(const mapped_file &other) = delete;
+    mapped_file(mapped_file &&other);
+    mapped_file &operator=(mapped_file &&other);
+    ~mapped_file();
+    size_t len();
+    const char *data();
+};
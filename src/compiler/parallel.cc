@@ -0,0 +1,107 @@
+#include "parallel.hh"
+
+#include <algorithm>
+#include <thread>
+
+static void append(token_buffer &out, token kind, size_t start,
+                   size_t length) {
+    out.kinds.push_back(kind);
+    out.starts.push_back(start);
+    out.lengths.push_back(kind == token::ERROR ? 0 : length);
+    out.size++;
+}
+
+static void lex_chunk(const input_unit *data, size_t length, size_t begin,
+                      size_t end, token_buffer *result) {
+    // tokens may run past the end of the chunk, only their starts are
+    // limited to it. reserving for short tokens only costs address space
+    result->kinds.reserve((end - begin) / 2 + 1);
+    result->starts.reserve((end - begin) / 2 + 1);
+    result->lengths.reserve((end - begin) / 2 + 1);
+    size_t position = begin;
+    while (position < end) {
+        token kind;
+        size_t token_length = dfa::scan(data, length, position, &kind);
+        append(*result, kind, position, token_length);
+        if (kind == token::ERROR) {
+            break;
+        }
+        position += token_length;
+    }
+}
+
+token_buffer lex_parallel(const input_unit *data, size_t length,
+                          unsigned threads) {
+    // every chunk is lexed speculatively as if a token started at its first
+    // unit. a dfa lexer only looks forward, so once the real token
+    // boundaries reach any token start of a chunk, the rest of that chunk's
+    // tokens are exactly the sequential ones. the chunks are stitched by
+    // lexing sequentially from the real boundary until it lands on one.
+    // the first chunk starts on a real boundary and is lexed into the
+    // result directly
+    threads = std::max(1u, threads);
+    std::vector<token_buffer> chunks(threads);
+    std::vector<size_t> bounds;
+    for (unsigned k = 0; k <= threads; k++) {
+        bounds.push_back(length * k / threads);
+    }
+    std::vector<std::thread> workers;
+    for (unsigned k = 1; k < threads; k++) {
+        workers.emplace_back(lex_chunk, data, length, bounds[k],
+                             bounds[k + 1], &chunks[k]);
+    }
+    token_buffer out;
+    lex_chunk(data, length, bounds[0], bounds[1], &out);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    if (out.size != 0 && out.kinds.back() == token::ERROR) {
+        return out;
+    }
+    size_t position =
+        out.size != 0 ? out.starts.back() + out.lengths.back() : 0;
+
+    for (unsigned k = 1; k < threads; k++) {
+        token_buffer &chunk = chunks[k];
+        auto synced = chunk.starts.end();
+        while (position < bounds[k + 1]) {
+            synced = std::lower_bound(chunk.starts.begin(), chunk.starts.end(),
+                                      position);
+            if (synced != chunk.starts.end() && *synced == position) {
+                break;
+            }
+            synced = chunk.starts.end();
+            token kind;
+            size_t token_length = dfa::scan(data, length, position, &kind);
+            append(out, kind, position, token_length);
+            if (kind == token::ERROR) {
+                return out;
+            }
+            position += token_length;
+        }
+        if (synced == chunk.starts.end()) {
+            continue;
+        }
+        size_t from = synced - chunk.starts.begin();
+        out.kinds.insert(out.kinds.end(), chunk.kinds.begin() + from,
+                         chunk.kinds.end());
+        out.starts.insert(out.starts.end(), chunk.starts.begin() + from,
+                          chunk.starts.end());
+        out.lengths.insert(out.lengths.end(), chunk.lengths.begin() + from,
+                           chunk.lengths.end());
+        out.size = out.kinds.size();
+        if (chunk.kinds.back() == token::ERROR) {
+            return out;
+        }
+        position = chunk.starts.back() + chunk.lengths.back();
+    }
+    while (1) {
+        token kind;
+        size_t token_length = dfa::scan(data, length, position, &kind);
+        append(out, kind, position, token_length);
+        if (kind == token::ERROR) {
+            return out;
+        }
+        position += token_length;
+    }
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "lexer.hh"
+
+// lexes a whole buffer on several threads, with the same tokens as calling
+// lexer::next until it returns ERROR. the last token is always the ERROR,
+// with a length of 0
+token_buffer lex_parallel(const input_unit *data, size_t length,
+                          unsigned threads);
@@ -0,0 +1,71 @@
+#include "push.hh"
+
+push_lexer::push_lexer()
+    : m_state(dfa::start(0)), m_offset(0), m_ended(false) {}
+
+push_lexer::push_lexer(lexer_state state)
+    : m_state(state), m_offset(state.start), m_ended(false) {}
+
+lexer_state push_lexer::state() { return this->m_state; }
+
+void push_lexer::emit(token_buffer &tokens, token kind, size_t start,
+                      size_t end, const input_unit *data, size_t base) {
+    // the token's units are in data when it started inside it, otherwise
+    // its beginning is pending from earlier pieces
+    if (kind == token::ERROR) {
+        this->m_ended = true;
+    } else if (start >= base) {
+        kind = dfa::keyword(kind, data + (start - base), end - start);
+    } else {
+        this->m_pending.insert(this->m_pending.end(), data, data + (end - base));
+        kind = dfa::keyword(kind, this->m_pending.data(),
+                            this->m_pending.size());
+    }
+    this->m_pending.clear();
+    tokens.kinds.push_back(kind);
+    tokens.starts.push_back(start);
+    tokens.lengths.push_back(kind == token::ERROR ? 0 : end - start);
+    tokens.size++;
+}
+
+size_t push_lexer::feed(const input_unit *data, size_t length,
+                        token_buffer &tokens) {
+    tokens.kinds.resize(tokens.size);
+    tokens.starts.resize(tokens.size);
+    tokens.lengths.resize(tokens.size);
+    size_t count = tokens.size;
+    size_t base = this->m_offset;
+    this->m_offset += length;
+    while (!this->m_ended) {
+        // after a restore the units up to state.position are fed again
+        // and only have to be kept for the open token
+        size_t from = this->m_state.position;
+        size_t start = this->m_state.start;
+        token kind;
+        if (from > this->m_offset ||
+            !dfa::resume(this->m_state, data + (from - base),
+                         this->m_offset - from, false, &kind)) {
+            size_t keep = start > base ? start - base : 0;
+            this->m_pending.insert(this->m_pending.end(), data + keep,
+                                   data + length);
+            break;
+        }
+        this->emit(tokens, kind, start, this->m_state.start, data, base);
+    }
+    return tokens.size - count;
+}
+
+size_t push_lexer::finish(token_buffer &tokens) {
+    tokens.kinds.resize(tokens.size);
+    tokens.starts.resize(tokens.size);
+    tokens.lengths.resize(tokens.size);
+    size_t count = tokens.size;
+    while (!this->m_ended) {
+        size_t start = this->m_state.start;
+        token kind;
+        dfa::resume(this->m_state, nullptr, 0, true, &kind);
+        this->emit(tokens, kind, start, this->m_state.start, nullptr,
+                   this->m_offset);
+    }
+    return tokens.size - count;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "lexer.hh"
+
+// a lexer that is handed its input piece by piece, as it arrives from a
+// pipe or socket, instead of reading it from a stream. only the units of
+// the token that is still open are kept between pieces
+class push_lexer {
+    lexer_state m_state;
+    size_t m_offset;
+    bool m_ended;
+    std::vector<input_unit> m_pending;
+    void emit(token_buffer &tokens, token kind, size_t start, size_t end,
+              const input_unit *data, size_t base);
+
+   public:
+    push_lexer();
+    // continues from a saved state, the input is then fed again from
+    // state.start on
+    push_lexer(lexer_state state);
+    // lexes the next length units of the input, appending every token that
+    // ends inside them to tokens. returns the number of tokens appended
+    size_t feed(const input_unit *data, size_t length, token_buffer &tokens);
+    // ends the input, appending the remaining tokens up to the final ERROR
+    size_t finish(token_buffer &tokens);
+    // the state to save as a checkpoint
+    lexer_state state();
+};
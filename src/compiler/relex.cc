@@ -0,0 +1,72 @@
+#include "relex.hh"
+
+token_range relex(token_buffer &tokens, const input_unit *data, size_t length,
+                  text_edit edit) {
+    // a token only depends on the units from its start up to and including
+    // the one after its end, which made the dfa stop. so the first token
+    // that can change is the first one ending at or after the edit, and
+    // every token starts in the same dfa state. lexing restarts at its
+    // start and stops once a new token starts where an old one did, behind
+    // the edit: from there on the dfa sees the same units as before
+    tokens.kinds.resize(tokens.size);
+    tokens.starts.resize(tokens.size);
+    tokens.lengths.resize(tokens.size);
+    size_t first = 0;
+    size_t last = tokens.size;
+    while (first < last) {
+        size_t middle = first + (last - first) / 2;
+        if (tokens.kinds[middle] != token::ERROR &&
+            tokens.starts[middle] + tokens.lengths[middle] < edit.offset) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    size_t position = first < tokens.size ? tokens.starts[first] : 0;
+
+    token_buffer fresh;
+    size_t synced = first;
+    while (1) {
+        if (position >= edit.offset + edit.inserted) {
+            // position in the new text is old + inserted - removed
+            while (synced < tokens.size &&
+                   tokens.starts[synced] + edit.inserted <
+                       position + edit.removed) {
+                synced++;
+            }
+            if (synced < tokens.size &&
+                tokens.starts[synced] + edit.inserted ==
+                    position + edit.removed) {
+                break;
+            }
+        }
+        token kind;
+        size_t token_length = dfa::scan(data, length, position, &kind);
+        fresh.kinds.push_back(kind);
+        fresh.starts.push_back(position);
+        fresh.lengths.push_back(kind == token::ERROR ? 0 : token_length);
+        if (kind == token::ERROR) {
+            synced = tokens.size;
+            break;
+        }
+        position += token_length;
+    }
+
+    for (size_t i = synced; i < tokens.size; i++) {
+        tokens.starts[i] = tokens.starts[i] + edit.inserted - edit.removed;
+    }
+    tokens.kinds.erase(tokens.kinds.begin() + first,
+                       tokens.kinds.begin() + synced);
+    tokens.kinds.insert(tokens.kinds.begin() + first, fresh.kinds.begin(),
+                        fresh.kinds.end());
+    tokens.starts.erase(tokens.starts.begin() + first,
+                        tokens.starts.begin() + synced);
+    tokens.starts.insert(tokens.starts.begin() + first, fresh.starts.begin(),
+                         fresh.starts.end());
+    tokens.lengths.erase(tokens.lengths.begin() + first,
+                         tokens.lengths.begin() + synced);
+    tokens.lengths.insert(tokens.lengths.begin() + first,
+                          fresh.lengths.begin(), fresh.lengths.end());
+    tokens.size = tokens.kinds.size();
+    return token_range{first, synced - first, fresh.kinds.size()};
+}
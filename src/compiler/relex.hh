@@ -0,0 +1,26 @@
+#pragma once
+
+#include "lexer.hh"
+
+// an edit of a buffer of input units, in units of the text before the edit:
+// removed units at offset were replaced by inserted units
+struct text_edit {
+    size_t offset;
+    size_t removed;
+    size_t inserted;
+};
+
+// the tokens that relex replaced, count_before tokens starting at first in
+// the old buffer became count_after tokens in the new one
+struct token_range {
+    size_t first;
+    size_t count_before;
+    size_t count_after;
+};
+
+// updates tokens, which were lexed from the text before edit up to and
+// including the final ERROR (as lex_parallel returns them), to the edited
+// text in data. only the tokens around the edit are lexed again, the rest
+// is reused with shifted starts
+token_range relex(token_buffer &tokens, const input_unit *data, size_t length,
+                  text_edit edit);
@@ -0,0 +1,143 @@
+#include "skip.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static inline bool in_set(const ascii_set &set, uint32_t c) {
+    return c < 128 && (set.bits[c & 15] >> (c >> 4) & 1);
+}
+
+static size_t span_bytes_scalar(const ascii_set &set, const char *bytes,
+                                size_t length) {
+    size_t i = 0;
+    while (i < length && in_set(set, (uint8_t)bytes[i])) {
+        i++;
+    }
+    return i;
+}
+
+static size_t span_chars_scalar(const ascii_set &set, const uint32_t *chars,
+                                size_t length) {
+    size_t i = 0;
+    while (i < length && in_set(set, chars[i])) {
+        i++;
+    }
+    return i;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// the high nibble selects one bit of the entry the low nibble looks up, high
+// nibbles of 8 and above select no bit so non-ASCII bytes leave the set
+#define HIGH_NIBBLE_BITS 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0
+
+__attribute__((target("sse4.1"))) static inline unsigned outside_mask(
+    __m128i block, __m128i low, __m128i high) {
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i bits = _mm_and_si128(
+        _mm_shuffle_epi8(low, _mm_and_si128(block, nibble)),
+        _mm_shuffle_epi8(high,
+                         _mm_and_si128(_mm_srli_epi16(block, 4), nibble)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bits, _mm_setzero_si128()));
+}
+
+__attribute__((target("sse4.1"))) static size_t span_bytes_sse(
+    const ascii_set &set, const char *bytes, size_t length) {
+    const __m128i low = _mm_loadu_si128((const __m128i *)set.bits);
+    const __m128i high = _mm_setr_epi8(HIGH_NIBBLE_BITS);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        unsigned mask = outside_mask(
+            _mm_loadu_si128((const __m128i *)(bytes + i)), low, high);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + span_bytes_scalar(set, bytes + i, length - i);
+}
+
+__attribute__((target("avx2"))) static size_t span_bytes_avx2(
+    const ascii_set &set, const char *bytes, size_t length) {
+    const __m256i low = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)set.bits));
+    const __m256i high =
+        _mm256_setr_epi8(HIGH_NIBBLE_BITS, HIGH_NIBBLE_BITS);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(bytes + i));
+        __m256i bits = _mm256_and_si256(
+            _mm256_shuffle_epi8(low, _mm256_and_si256(block, nibble)),
+            _mm256_shuffle_epi8(
+                high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble)));
+        uint32_t mask = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(bits, _mm256_setzero_si256()));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + span_bytes_sse(set, bytes + i, length - i);
+}
+
+__attribute__((target("sse4.1"))) static size_t span_chars_sse(
+    const ascii_set &set, const uint32_t *chars, size_t length) {
+    // code points are clamped to 255 and packed down to bytes, which keeps
+    // everything outside ASCII outside the set
+    const __m128i low = _mm_loadu_si128((const __m128i *)set.bits);
+    const __m128i high = _mm_setr_epi8(HIGH_NIBBLE_BITS);
+    const __m128i clamp = _mm_set1_epi32(255);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i *block = (const __m128i *)(chars + i);
+        __m128i a = _mm_min_epu32(_mm_loadu_si128(block), clamp);
+        __m128i b = _mm_min_epu32(_mm_loadu_si128(block + 1), clamp);
+        __m128i c = _mm_min_epu32(_mm_loadu_si128(block + 2), clamp);
+        __m128i d = _mm_min_epu32(_mm_loadu_si128(block + 3), clamp);
+        unsigned mask = outside_mask(
+            _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d)),
+            low, high);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + span_chars_scalar(set, chars + i, length - i);
+}
+#endif
+
+typedef size_t (*span_bytes_kernel)(const ascii_set &, const char *, size_t);
+typedef size_t (*span_chars_kernel)(const ascii_set &, const uint32_t *,
+                                    size_t);
+
+static span_bytes_kernel select_bytes_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return span_bytes_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return span_bytes_sse;
+    }
+#endif
+    return span_bytes_scalar;
+}
+
+static span_chars_kernel select_chars_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) {
+        return span_chars_sse;
+    }
+#endif
+    return span_chars_scalar;
+}
+
+size_t span_ascii_set(const ascii_set &set, const char *bytes, size_t length) {
+    static const span_bytes_kernel kernel = select_bytes_kernel();
+    return kernel(set, bytes, length);
+}
+
+size_t span_ascii_set(const ascii_set &set, const uint32_t *chars,
+                      size_t length) {
+    static const span_chars_kernel kernel = select_chars_kernel();
+    return kernel(set, chars, length);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// a set of ASCII characters in the layout of a PSHUFB class test: character
+// c is in the set if bit c >> 4 of bits[c & 15] is set. characters outside
+// ASCII are never in the set
+struct ascii_set {
+    uint8_t bits[16];
+};
+
+// length of the prefix of a buffer whose characters are all in the set
+size_t span_ascii_set(const ascii_set &set, const char *bytes, size_t length);
+size_t span_ascii_set(const ascii_set &set, const uint32_t *chars,
+                      size_t length);
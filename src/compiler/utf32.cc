@@ -2,8 +2,15 @@
 
 using namespace utf32;
 
-#include <sstream>
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <iterator>
+#include <sstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 struct TypeUTF8 {
     uint8_t mask;
@@ -43,6 +50,350 @@ chr_t utf32::decode_utf8(std::istream &stream) {
     throw std::runtime_error("invalid utf8 start character");
 }
 
+// decodes the multi-byte sequence starting at bytes[i], all decoders share
+// this so they report malformed input the same way
+static inline size_t decode_sequence(const uint8_t *bytes, size_t i,
+                                     size_t length, chr_t *out) {
+    chr_t next = bytes[i];
+    for (auto const &utf8_type : utf8_types) {
+        if ((next & utf8_type.mask) == utf8_type.value) {
+            chr_t result = next & ~utf8_type.mask;
+            for (uint8_t k = 1; k <= utf8_type.extra; k++) {
+                if (i + k >= length) {
+                    throw std::runtime_error(
+                        "unexpected end of utf8 sequence");
+                }
+                if ((bytes[i + k] & 0xC0) != 0x80) {
+                    throw std::runtime_error(
+                        "invalid utf8 continuation character");
+                }
+                result = (result << 6) | (bytes[i + k] & 0x3f);
+            }
+            *out = result;
+            return utf8_type.extra + 1;
+        }
+    }
+    throw std::runtime_error("invalid utf8 start character");
+}
+
+static size_t decode_utf8_scalar(const uint8_t *bytes, size_t length,
+                                 chr_t *out, size_t count, size_t *read) {
+    size_t i = 0;
+    size_t n = 0;
+    while (n < count && i < length) {
+        if (bytes[i] < 0x80) {
+            out[n++] = bytes[i++];
+        } else {
+            i += decode_sequence(bytes, i, length, out + n++);
+        }
+    }
+    *read = i;
+    return n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// the vector kernels widen whole blocks of ASCII at once. other input is
+// checked 32 bytes at a time with the lookup tables of Keiser and Lemire
+// (as in simdutf), reduced to the shape of the sequences: lead bytes,
+// continuations and lengths. like the scalar decoder they don't look at the
+// decoded value, so overlong forms and surrogates pass. valid windows are
+// transcoded four code points of up to three bytes per shuffle. sequences
+// of four bytes, invalid windows and the tail are left to decode_sequence,
+// so the kernels accept and reject exactly the same input as the scalar
+// decoder
+
+// error bits of a byte by the high nibble of the byte before it and the
+// high nibble of the byte itself, a byte is in error when both lookups
+// share a bit
+#define UTF8_TOO_SHORT 0x01
+#define UTF8_TOO_LONG 0x02
+#define UTF8_TWO_CONTS 0x80
+
+alignas(16) static const uint8_t utf8_byte_1_high[16] = {
+    UTF8_TOO_LONG,  UTF8_TOO_LONG,  UTF8_TOO_LONG,  UTF8_TOO_LONG,
+    UTF8_TOO_LONG,  UTF8_TOO_LONG,  UTF8_TOO_LONG,  UTF8_TOO_LONG,
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT};
+
+alignas(16) static const uint8_t utf8_byte_2_high[16] = {
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_TWO_CONTS, UTF8_TOO_LONG | UTF8_TWO_CONTS,
+    UTF8_TOO_LONG | UTF8_TWO_CONTS, UTF8_TOO_LONG | UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT};
+
+// for every pattern of code point ends in the first 12 bytes of a block, the
+// leading code points of at most three bytes, up to four of them, and the
+// shuffle that moves each into a 32 bit lane with its last byte lowest and
+// missing bytes zero. shuffles are indexed by the lengths as base 4 digits
+struct decode_step {
+    uint8_t shuffle;
+    uint8_t consumed;
+    uint8_t count;
+};
+
+static decode_step decode_steps[1 << 12];
+alignas(16) static uint8_t decode_shuffles[256][16];
+
+static void build_decode_steps() {
+    for (uint32_t ends = 0; ends < (1 << 12); ends++) {
+        uint8_t shuffle[16];
+        std::memset(shuffle, 0x80, sizeof(shuffle));
+        uint8_t index = 0;
+        uint8_t count = 0;
+        uint8_t position = 0;
+        while (count < 4 && position < 12) {
+            uint8_t end = position;
+            while (end < 12 && !(ends >> end & 1)) {
+                end++;
+            }
+            if (end == 12 || end - position > 2) {
+                break;
+            }
+            for (uint8_t k = 0; k <= end - position; k++) {
+                shuffle[4 * count + k] = end - k;
+            }
+            index = index * 4 + (end - position + 1);
+            count++;
+            position = end + 1;
+        }
+        std::memcpy(decode_shuffles[index], shuffle, sizeof(shuffle));
+        decode_steps[ends] = decode_step{index, position, count};
+    }
+}
+
+__attribute__((target("sse4.1"))) static inline __m128i utf8_errors_sse(
+    __m128i input, __m128i prev_input) {
+    __m128i low_nibbles = _mm_set1_epi8(0x0f);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i byte_1_high = _mm_shuffle_epi8(
+        _mm_load_si128((const __m128i *)utf8_byte_1_high),
+        _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibbles));
+    __m128i byte_2_high = _mm_shuffle_epi8(
+        _mm_load_si128((const __m128i *)utf8_byte_2_high),
+        _mm_and_si128(_mm_srli_epi16(input, 4), low_nibbles));
+    __m128i special = _mm_and_si128(byte_1_high, byte_2_high);
+    // the third and fourth byte of a sequence have to be continuations, the
+    // only place where two of them may follow each other
+    __m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, prev_input, 14),
+                                  _mm_set1_epi8(0xe0 - 0x80));
+    __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, prev_input, 13),
+                                   _mm_set1_epi8(0xf0 - 0x80));
+    __m128i must_continue = _mm_and_si128(_mm_or_si128(third, fourth),
+                                          _mm_set1_epi8((char)0x80));
+    // no sequence starts with f8 to ff
+    __m128i no_start = _mm_subs_epu8(input, _mm_set1_epi8((char)0xf7));
+    return _mm_or_si128(_mm_xor_si128(must_continue, special), no_start);
+}
+
+// true when the 32 bytes at bytes, which start at a code point, hold no
+// invalid sequence. a sequence cut off by the end of the window is not an
+// error yet
+__attribute__((target("sse4.1"))) static inline bool utf8_valid_sse(
+    const uint8_t *bytes) {
+    __m128i first = _mm_loadu_si128((const __m128i *)bytes);
+    __m128i second = _mm_loadu_si128((const __m128i *)(bytes + 16));
+    if (_mm_movemask_epi8(_mm_or_si128(first, second)) == 0) {
+        return true;
+    }
+    __m128i errors = _mm_or_si128(utf8_errors_sse(first, _mm_setzero_si128()),
+                                  utf8_errors_sse(second, first));
+    return _mm_testz_si128(errors, errors);
+}
+
+// transcodes the leading code points of the 16 bytes at bytes to out,
+// returning the number of bytes used, 0 when the first code point takes
+// four bytes. writes up to 16 units to out
+__attribute__((target("sse4.1"))) static inline size_t decode_block_sse(
+    const uint8_t *bytes, chr_t *out, size_t *n) {
+    __m128i block = _mm_loadu_si128((const __m128i *)bytes);
+    __m128i *target = (__m128i *)out;
+    int mask = _mm_movemask_epi8(block);
+    // a run of ascii longer than a shuffle would take is widened whole
+    size_t ascii = mask == 0 ? 16 : __builtin_ctz(mask);
+    if (ascii >= 4) {
+        _mm_storeu_si128(target, _mm_cvtepu8_epi32(block));
+        _mm_storeu_si128(target + 1,
+                         _mm_cvtepu8_epi32(_mm_srli_si128(block, 4)));
+        _mm_storeu_si128(target + 2,
+                         _mm_cvtepu8_epi32(_mm_srli_si128(block, 8)));
+        _mm_storeu_si128(target + 3,
+                         _mm_cvtepu8_epi32(_mm_srli_si128(block, 12)));
+        *n += ascii;
+        return ascii;
+    }
+    uint32_t starts = ~(uint32_t)_mm_movemask_epi8(
+        _mm_cmplt_epi8(block, _mm_set1_epi8((char)0xc0)));
+    const decode_step &step = decode_steps[starts >> 1 & 0xfff];
+    __m128i lanes = _mm_shuffle_epi8(
+        block, _mm_load_si128((const __m128i *)decode_shuffles[step.shuffle]));
+    // ascii or the last byte, the middle or a two byte lead, a three byte
+    // lead. the masks drop the marker bits of every kind of byte
+    __m128i last = _mm_and_si128(lanes, _mm_set1_epi32(0x7f));
+    __m128i middle =
+        _mm_srli_epi32(_mm_and_si128(lanes, _mm_set1_epi32(0x3f00)), 2);
+    __m128i lead =
+        _mm_srli_epi32(_mm_and_si128(lanes, _mm_set1_epi32(0x0f0000)), 4);
+    _mm_storeu_si128(target, _mm_or_si128(_mm_or_si128(last, middle), lead));
+    *n += step.count;
+    return step.consumed;
+}
+
+// transcodes the code points starting in the first 17 bytes of a validated
+// 32 byte window at bytes[i], so every block read stays inside the window.
+// returns the position after the last code point, writes up to 48 units
+__attribute__((target("sse4.1"))) static inline size_t decode_window_sse(
+    const uint8_t *bytes, size_t i, size_t length, chr_t *out, size_t *n) {
+    size_t end = i + 16;
+    while (i <= end) {
+        size_t used = decode_block_sse(bytes + i, out + *n, n);
+        if (used == 0) {
+            used = decode_sequence(bytes, i, length, out + (*n)++);
+        }
+        i += used;
+    }
+    return i;
+}
+
+__attribute__((target("sse4.1"))) static size_t decode_utf8_sse(
+    const uint8_t *bytes, size_t length, chr_t *out, size_t count,
+    size_t *read) {
+    size_t i = 0;
+    size_t n = 0;
+    while (n < count && i < length) {
+        while (i + 32 <= length && n + 64 <= count &&
+               utf8_valid_sse(bytes + i)) {
+            i = decode_window_sse(bytes, i, length, out, &n);
+        }
+        if (n == count || i == length) {
+            break;
+        }
+        if (bytes[i] < 0x80) {
+            out[n++] = bytes[i++];
+        } else {
+            i += decode_sequence(bytes, i, length, out + n++);
+        }
+    }
+    *read = i;
+    return n;
+}
+
+__attribute__((target("avx2"))) static inline bool utf8_valid_avx2(
+    const uint8_t *bytes) {
+    // the window starts at a code point, so the bytes before it count as
+    // ascii. alignr shifts within 128 bit lanes, the permute brings the
+    // bytes of the lower lane over
+    __m256i input = _mm256_loadu_si256((const __m256i *)bytes);
+    __m256i prev_input =
+        _mm256_permute2x128_si256(_mm256_setzero_si256(), input, 0x21);
+    __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    __m256i prev1 = _mm256_alignr_epi8(input, prev_input, 15);
+    __m256i byte_1_high = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(
+            _mm_load_si128((const __m128i *)utf8_byte_1_high)),
+        _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibbles));
+    __m256i byte_2_high = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(
+            _mm_load_si128((const __m128i *)utf8_byte_2_high)),
+        _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibbles));
+    __m256i special = _mm256_and_si256(byte_1_high, byte_2_high);
+    __m256i third =
+        _mm256_subs_epu8(_mm256_alignr_epi8(input, prev_input, 14),
+                         _mm256_set1_epi8(0xe0 - 0x80));
+    __m256i fourth =
+        _mm256_subs_epu8(_mm256_alignr_epi8(input, prev_input, 13),
+                         _mm256_set1_epi8(0xf0 - 0x80));
+    __m256i must_continue = _mm256_and_si256(
+        _mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    __m256i no_start =
+        _mm256_subs_epu8(input, _mm256_set1_epi8((char)0xf7));
+    __m256i errors =
+        _mm256_or_si256(_mm256_xor_si256(must_continue, special), no_start);
+    return _mm256_testz_si256(errors, errors);
+}
+
+__attribute__((target("avx2"))) static size_t decode_utf8_avx2(
+    const uint8_t *bytes, size_t length, chr_t *out, size_t count,
+    size_t *read) {
+    size_t i = 0;
+    size_t n = 0;
+    while (n < count && i < length) {
+        while (i + 32 <= length && n + 64 <= count) {
+            __m256i block = _mm256_loadu_si256((const __m256i *)(bytes + i));
+            if (_mm256_movemask_epi8(block) != 0) {
+                if (!utf8_valid_avx2(bytes + i)) {
+                    break;
+                }
+                i = decode_window_sse(bytes, i, length, out, &n);
+                continue;
+            }
+            __m256i *target = (__m256i *)(out + n);
+            for (int part = 0; part < 4; part++) {
+                __m128i eight =
+                    _mm_loadl_epi64((const __m128i *)(bytes + i + part * 8));
+                _mm256_storeu_si256(target + part, _mm256_cvtepu8_epi32(eight));
+            }
+            i += 32;
+            n += 32;
+        }
+        if (n == count || i == length) {
+            break;
+        }
+        if (bytes[i] < 0x80) {
+            out[n++] = bytes[i++];
+        } else {
+            i += decode_sequence(bytes, i, length, out + n++);
+        }
+    }
+    *read = i;
+    return n;
+}
+#endif
+
+typedef size_t (*decode_kernel)(const uint8_t *, size_t, chr_t *, size_t,
+                                size_t *);
+
+static decode_kernel select_decode_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        build_decode_steps();
+        return decode_utf8_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        build_decode_steps();
+        return decode_utf8_sse;
+    }
+#endif
+    return decode_utf8_scalar;
+}
+
+size_t utf32::decode_utf8(const char *in, size_t length, chr_t *out,
+                          size_t count, size_t *read) {
+    static const decode_kernel kernel = select_decode_kernel();
+    return kernel((const uint8_t *)in, length, out, count, read);
+}
+
+// length of the prefix of a chunk that doesn't end in the middle of a
+// sequence, the rest is carried over to the next chunk
+static size_t complete_prefix(const char *in, size_t length) {
+    const uint8_t *bytes = (const uint8_t *)in;
+    for (size_t back = 1; back <= 4 && back <= length; back++) {
+        uint8_t next = bytes[length - back];
+        if ((next & 0xC0) == 0x80) {
+            continue;
+        }
+        for (auto const &utf8_type : utf8_types) {
+            if ((next & utf8_type.mask) == utf8_type.value) {
+                return (size_t)utf8_type.extra + 1 > back ? length - back
+                                                          : length;
+            }
+        }
+        return length;
+    }
+    return length;
+}
+
 void utf32::write_utf8(std::ostream &stream, chr_t ch) {
     if (ch < 0x80) {
         stream << (char)ch;
@@ -63,10 +414,7 @@ void utf32::write_utf8(std::ostream &stream, chr_t ch) {
 
 string::string(std::istream &in_stream) { this->init(in_stream); }
 
-string::string(std::string str) {
-    std::istringstream in_stream(str);
-    this->init(in_stream);
-}
+string::string(std::string str) { this->init(str.data(), str.size()); }
 
 string::string(string &&other) {
     this->m_data = other.m_data;
@@ -82,27 +430,21 @@ string::string(const string &other) {
 }
 
 void string::init(std::istream &in_stream) {
-    this->m_length = 0;
-    size_t cap = 4;
-    this->m_data = (chr_t *)std::malloc(sizeof(chr_t) * cap);
-    while (1) {
-        chr_t a = utf32::decode_utf8(in_stream);
-        if (a == -1) {
-            break;
-        }
-        if (this->m_length + 1 == cap) {
-            cap <<= 1;
-            chr_t *tmp_data =
-                (chr_t *)std::realloc(this->m_data, sizeof(chr_t) * cap);
-            if (tmp_data != nullptr) {
-                this->m_data = tmp_data;
-            } else {
-                throw std::runtime_error("out of memory while reading utf8");
-            }
-        }
-        this->m_data[this->m_length] = a;
-        this->m_length++;
+    std::string bytes(std::istreambuf_iterator<char>(in_stream),
+                      std::istreambuf_iterator<char>{});
+    this->init(bytes.data(), bytes.size());
+}
+
+void string::init(const char *bytes, size_t length) {
+    // a code point takes at least one byte, so the byte count bounds the
+    // decoded length
+    this->m_data = (chr_t *)std::malloc(sizeof(chr_t) * std::max<size_t>(length, 1));
+    if (this->m_data == nullptr) {
+        throw std::runtime_error("out of memory while reading utf8");
     }
+    size_t read;
+    this->m_length =
+        utf32::decode_utf8(bytes, length, this->m_data, length, &read);
     this->m_data =
         (chr_t *)std::realloc(this->m_data, sizeof(chr_t) * this->m_length);
 }
@@ -147,25 +489,172 @@ namespace utf32 {
     }
 }
 
-stream::stream(std::istream &in_stream) : m_data(in_stream), m_position(0) {}
+stream::stream(std::istream &in_stream)
+    : m_base(0),
+      m_position(0),
+      m_pin(SIZE_MAX),
+      m_source(nullptr),
+      m_offset(0),
+      m_chunk(0) {
+    std::string bytes(std::istreambuf_iterator<char>(in_stream),
+                      std::istreambuf_iterator<char>{});
+    size_t read;
+    this->m_window.resize(bytes.size());
+    this->m_window.resize(utf32::decode_utf8(bytes.data(), bytes.size(),
+                                             this->m_window.data(),
+                                             bytes.size(), &read));
+}
+
+stream::stream(std::istream &in_stream, size_t chunk)
+    : m_base(0),
+      m_position(0),
+      m_pin(SIZE_MAX),
+      m_source(&in_stream),
+      m_offset(0),
+      m_chunk(chunk) {}
 
-stream::stream(std::string in_string) : m_data(in_string), m_position(0) {}
+stream::stream(mapped_file file, size_t chunk)
+    : m_base(0),
+      m_position(0),
+      m_pin(SIZE_MAX),
+      m_source(nullptr),
+      m_file(std::move(file)),
+      m_offset(0),
+      m_chunk(chunk) {}
+
+stream::stream(std::string in_string) : stream(string(in_string)) {}
 
 stream::stream(string in_utf32_string)
-    : m_data(in_utf32_string), m_position(0) {}
+    : m_window(in_utf32_string.data(),
+               in_utf32_string.data() + in_utf32_string.len()),
+      m_base(0),
+      m_position(0),
+      m_pin(SIZE_MAX),
+      m_source(nullptr),
+      m_offset(0),
+      m_chunk(0) {}
+
+void stream::reset(mapped_file file) {
+    this->m_window.clear();
+    this->m_base = 0;
+    this->m_position = 0;
+    this->m_pin = SIZE_MAX;
+    this->m_source = nullptr;
+    this->m_pending.clear();
+    this->m_file = std::move(file);
+    this->m_offset = 0;
+    if (this->m_chunk == 0) {
+        this->m_chunk = 1 << 16;
+    }
+    this->m_lines.reset();
+}
+
+size_t stream::decode_chunk() {
+    size_t old_size = this->m_window.size();
+    if (this->m_offset < this->m_file.len()) {
+        size_t read;
+        this->m_window.resize(old_size + this->m_chunk);
+        size_t decoded = utf32::decode_utf8(
+            this->m_file.data() + this->m_offset,
+            this->m_file.len() - this->m_offset,
+            this->m_window.data() + old_size, this->m_chunk, &read);
+        this->m_window.resize(old_size + decoded);
+        this->m_offset += read;
+        return decoded;
+    }
+    while (this->m_source != nullptr && this->m_window.size() == old_size) {
+        // read raw bytes and decode them in bulk, a sequence cut off at the
+        // end of the chunk waits in m_pending for the next read
+        size_t carried = this->m_pending.size();
+        this->m_pending.resize(carried + this->m_chunk);
+        this->m_source->read(this->m_pending.data() + carried, this->m_chunk);
+        size_t filled = carried + this->m_source->gcount();
+        size_t length = filled;
+        if (filled < this->m_pending.size()) {
+            this->m_source = nullptr;
+        } else {
+            length = complete_prefix(this->m_pending.data(), filled);
+        }
+        size_t read;
+        this->m_window.resize(old_size + length);
+        this->m_window.resize(
+            old_size + utf32::decode_utf8(this->m_pending.data(), length,
+                                          this->m_window.data() + old_size,
+                                          length, &read));
+        this->m_pending.erase(0, read);
+        this->m_pending.resize(filled - read);
+    }
+    return this->m_window.size() - old_size;
+}
+
+bool stream::refill(size_t position) {
+    if (this->m_source == nullptr && this->m_offset == this->m_file.len()) {
+        return false;
+    }
+    size_t keep = std::min(this->m_pin, position);
+    this->scan_lines(keep);
+    this->m_window.erase(this->m_window.begin(),
+                         this->m_window.begin() + (keep - this->m_base));
+    this->m_base = keep;
+    while (position - this->m_base >= this->m_window.size()) {
+        if (this->decode_chunk() == 0) {
+            return false;
+        }
+    }
+    return true;
+}
 
 chr_t stream::get() {
     size_t p = this->m_position++;
-    if (p >= this->m_data.len()) {
+    if (p - this->m_base >= this->m_window.size() && !this->refill(p)) {
         return -1;
     }
-    return this->m_data[p];
+    return this->m_window[p - this->m_base];
 }
 
 size_t stream::pos() { return this->m_position; }
 
-bool stream::end() { return this->m_position == this->m_data.len(); }
+bool stream::end() {
+    if (this->m_position - this->m_base < this->m_window.size()) {
+        return false;
+    }
+    return !this->refill(this->m_position);
+}
+
+size_t stream::pin() {
+    this->m_pin = this->m_position;
+    return this->m_position;
+}
 
-string &stream::data() { return this->m_data; }
+void stream::unpin() { this->m_pin = SIZE_MAX; }
+
+size_t stream::skip(const ascii_set &set) {
+    // only looks at what is already decoded, the next get refills as usual
+    size_t offset = this->m_position - this->m_base;
+    if (offset >= this->m_window.size()) {
+        return 0;
+    }
+    size_t count = span_ascii_set(set, this->m_window.data() + offset,
+                                  this->m_window.size() - offset);
+    this->m_position += count;
+    return count;
+}
+
+stringref stream::ref(size_t offset, size_t length) {
+    return stringref(this->m_window.data() + (offset - this->m_base), length);
+}
+
+void stream::back() { this->m_position--; }
+
+void stream::scan_lines(size_t until) {
+    size_t scanned = this->m_lines.scanned();
+    if (until > scanned) {
+        this->m_lines.scan(this->m_window.data() + (scanned - this->m_base),
+                           until - scanned);
+    }
+}
 
-void stream::back() { this->m_position--; }
\ No newline at end of file
+position stream::locate(size_t offset) {
+    this->scan_lines(this->m_base + this->m_window.size());
+    return this->m_lines.locate(offset);
+}
\ No newline at end of file
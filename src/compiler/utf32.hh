@@ -2,17 +2,25 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+
+#include "lines.hh"
+#include "mapping.hh"
+#include "skip.hh"
 
 namespace utf32 {
     typedef uint32_t chr_t;
 
     inline chr_t decode_utf8(std::istream &in_stream);
     inline void write_utf8(std::ostream &stream, chr_t ch);
+    size_t decode_utf8(const char *in, size_t length, chr_t *out,
+                       size_t count, size_t *read);
 
     class string {
         size_t m_length;
         chr_t *m_data;
         void init(std::istream &in_stream);
+        void init(const char *bytes, size_t length);
 
        public:
         string(std::istream &in_stream);
@@ -39,20 +47,43 @@ namespace utf32 {
         friend std::ostream &operator<<(std::ostream &stream, stringref &str);
     };
 
+    // reads code points either from a fully decoded string or, when
+    // constructed with a chunk size, by decoding its source in chunks into
+    // a sliding window. data before the pinned position is dropped from the
+    // window whenever it is refilled, after its line starts are recorded
     class stream {
-        string m_data;
+        std::vector<chr_t> m_window;
+        size_t m_base;
         size_t m_position;
+        size_t m_pin;
+        std::istream *m_source;
+        std::string m_pending;
+        mapped_file m_file;
+        size_t m_offset;
+        size_t m_chunk;
+        line_index m_lines;
+        size_t decode_chunk();
+        void scan_lines(size_t until);
+        bool refill(size_t position);
 
        public:
         stream(string s);
         stream(std::istream &in_stream);
+        stream(std::istream &in_stream, size_t chunk);
+        stream(mapped_file file, size_t chunk = 1 << 16);
         stream(std::string cpp_string);
         stream(const stream &other) = delete;
         stream(stream &&other) = default;
+        // starts over on file, reusing the window of the previous input
+        void reset(mapped_file file);
         chr_t get();
         void back();
         size_t pos();
         bool end();
-        string &data();
+        size_t pin();
+        void unpin();
+        size_t skip(const ascii_set &set);
+        stringref ref(size_t offset, size_t length);
+        position locate(size_t offset);
     };
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "utf8.hh"
+
+using namespace utf8;
+
+#include <algorithm>
+#include <iterator>
+
+stringref::stringref(std::string &str, size_t offset, size_t length) {
+    this->m_start = str.data() + offset;
+    this->m_length = length;
+}
+
+stringref::stringref(const char *start, size_t length) {
+    this->m_start = start;
+    this->m_length = length;
+}
+
+size_t stringref::len() { return this->m_length; }
+
+const char *stringref::data() { return this->m_start; }
+
+char stringref::operator[](size_t index) { return this->m_start[index]; }
+
+namespace utf8 {
+    std::ostream &operator<<(std::ostream &stream, stringref &str) {
+        return stream.write(str.m_start, str.m_length);
+    }
+}
+
+stream::stream(std::istream &in_stream)
+    : m_data(std::istreambuf_iterator<char>(in_stream),
+             std::istreambuf_iterator<char>()),
+      m_bytes(m_data.data()),
+      m_length(m_data.size()),
+      m_position(0) {}
+
+stream::stream(std::string in_string)
+    : m_data(std::move(in_string)),
+      m_bytes(m_data.data()),
+      m_length(m_data.size()),
+      m_position(0) {}
+
+stream::stream(mapped_file file)
+    : m_file(std::move(file)),
+      m_bytes(m_file.data()),
+      m_length(m_file.len()),
+      m_position(0) {}
+
+stream::stream(stream &&other)
+    : m_data(std::move(other.m_data)),
+      m_file(std::move(other.m_file)),
+      m_length(other.m_length),
+      m_position(other.m_position),
+      m_lines(std::move(other.m_lines)) {
+    this->m_bytes =
+        this->m_file.data() != nullptr ? this->m_file.data() : m_data.data();
+}
+
+void stream::reset(mapped_file file) {
+    this->m_data.clear();
+    this->m_file = std::move(file);
+    this->m_bytes = this->m_file.data();
+    this->m_length = this->m_file.len();
+    this->m_position = 0;
+    this->m_lines.reset();
+}
+
+utf32::chr_t stream::get() {
+    size_t p = this->m_position++;
+    if (p >= this->m_length) {
+        return -1;
+    }
+    return (uint8_t)this->m_bytes[p];
+}
+
+size_t stream::pos() { return this->m_position; }
+
+bool stream::end() { return this->m_position == this->m_length; }
+
+size_t stream::pin() { return this->m_position; }
+
+void stream::unpin() {}
+
+size_t stream::skip(const ascii_set &set) {
+    size_t count = span_ascii_set(set, this->m_bytes + this->m_position,
+                                  this->m_length - this->m_position);
+    this->m_position += count;
+    return count;
+}
+
+stringref stream::ref(size_t offset, size_t length) {
+    return stringref(this->m_bytes + offset, length);
+}
+
+void stream::back() { this->m_position--; }
+
+position stream::locate(size_t offset) {
+    // lines are scanned in large blocks ahead of the requested offset, so
+    // asking for every token's position stays cheap
+    size_t scanned = this->m_lines.scanned();
+    if (offset >= scanned && scanned < this->m_length) {
+        size_t until = std::min(this->m_length,
+                                std::max(offset + 1, scanned + (1 << 16)));
+        this->m_lines.scan(this->m_bytes + scanned, until - scanned);
+    }
+    return this->m_lines.locate(offset);
+}
\ No newline at end of file
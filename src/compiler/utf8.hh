@@ -0,0 +1,52 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "lines.hh"
+#include "mapping.hh"
+#include "skip.hh"
+#include "utf32.hh"
+
+namespace utf8 {
+    class stringref {
+        const char *m_start;
+        size_t m_length;
+
+       public:
+        stringref(std::string &str, size_t offset, size_t length);
+        stringref(const char *start, size_t length);
+        size_t len();
+        const char *data();
+        char operator[](size_t index);
+        friend std::ostream &operator<<(std::ostream &stream, stringref &str);
+    };
+
+    // reads the bytes of a string it owns or of a mapped file
+    class stream {
+        std::string m_data;
+        mapped_file m_file;
+        const char *m_bytes;
+        size_t m_length;
+        size_t m_position;
+        line_index m_lines;
+
+       public:
+        stream(std::istream &in_stream);
+        stream(std::string cpp_string);
+        stream(mapped_file file);
+        stream(const stream &other) = delete;
+        stream(stream &&other);
+        // starts over on file
+        void reset(mapped_file file);
+        utf32::chr_t get();
+        void back();
+        size_t pos();
+        bool end();
+        size_t pin();
+        void unpin();
+        size_t skip(const ascii_set &set);
+        stringref ref(size_t offset, size_t length);
+        position locate(size_t offset);
+    };
+}